@@ -1,12 +1,21 @@
+#include <algorithm>
 #include <array>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
 #include <cstdlib>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <memory_resource>
+#include <numeric>
 #include <random>
 #include <ranges>
 #include <span>
+#include <string>
 #include <string_view>
+#include <vector>
 
 namespace
 {
@@ -15,7 +24,9 @@ namespace
     std::cout << prefix << ":";
     std::ranges::copy(data                                                        //
                         | std::views::transform(&std::to_integer<unsigned char>)  //
-                        | std::views::transform([](const auto c) -> char { return std::isprint(c) ? c : '#'; }),
+                        | std::views::transform([](const auto c) -> char {
+                            return std::isprint(c) ? static_cast<char>(c) : '#';
+                          }),
                       std::ostream_iterator<unsigned char>(std::cout));
     std::cout << std::endl;
   }
@@ -27,7 +38,7 @@ namespace
 
   struct product_pmr_alloc_aware
   {
-    using allocator_type = std::pmr::polymorphic_allocator<>;
+    using allocator_type = std::pmr::string::allocator_type;
 
     constexpr product_pmr_alloc_aware(const allocator_type& alloc = {}) : name(alloc) {}
     explicit constexpr product_pmr_alloc_aware(const std::string_view s, const allocator_type& alloc = {})
@@ -54,10 +65,178 @@ namespace
     objects.emplace_back(T{"foo bar baz qux lorem ipsum dolor"});
     print("#1", buffer);
   }
+
+  template<typename Duration = std::chrono::milliseconds, typename Func>
+  auto measure(Func&& f)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration_cast<Duration>(std::chrono::steady_clock::now() - start);
+  }
+
+  // an allocator-aware container of products. Its vector constructs the products by uses-allocator construction:
+  // product_pmr_alloc_aware receives the allocator of the catalog, so its name is allocated from the same resource
+  // as the vector. product isn't allocator-aware, its name is allocated from the default resource.
+  template<typename Product>
+  class product_catalog
+  {
+  public:
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    explicit product_catalog(const allocator_type& alloc = {}) : products_(alloc) {}
+    product_catalog(const product_catalog& other, const allocator_type& alloc = {}) : products_(other.products_, alloc)
+    {}
+
+    void reserve(const size_t n) { products_.reserve(n); }
+
+    void add(const std::string_view name)
+    {
+      if constexpr (std::uses_allocator_v<Product, allocator_type>)
+        products_.emplace_back(name);
+      else
+        products_.emplace_back(std::pmr::string{name});
+    }
+
+    // reads every character of every name
+    size_t checksum() const
+    {
+      size_t sum = 0;
+      for (const auto& p : products_)
+        sum = std::accumulate(p.name.begin(), p.name.end(), sum,
+                              [](const size_t acc, const char c) { return acc + static_cast<unsigned char>(c); });
+
+      return sum;
+    }
+
+  private:
+    std::pmr::vector<Product> products_;
+  };
+
+  // factories of the resources the catalogs are run on, a resource is destroyed with the last pointer to it
+  std::shared_ptr<std::pmr::memory_resource> make_heap_resource()
+  {
+    // std::pmr::new_delete_resource() lives forever, the pointer doesn't own it
+    return {std::shared_ptr<void>{}, std::pmr::new_delete_resource()};
+  }
+
+  template<typename Resource>
+  std::shared_ptr<std::pmr::memory_resource> make_resource_on_heap()
+  {
+    return std::make_shared<Resource>(std::pmr::new_delete_resource());
+  }
+
+  // names of 16 to 63 characters, too long for the small string optimization
+  std::vector<std::string> generate_product_names(const size_t n)
+  {
+    static constexpr std::string_view filler = "lorem ipsum dolor sit amet consectetur adipiscing elit sed do";
+
+    std::mt19937 gen{42};
+    std::uniform_int_distribution<size_t> filler_length{0, 40};
+
+    std::vector<std::string> names(n);
+    for (size_t i = 0; i < n; ++i)
+      names[i] = "product " + std::to_string(i) + ' ' + std::string{filler.substr(0, filler_length(gen))};
+
+    return names;
+  }
+
+  struct catalog_timings
+  {
+    std::chrono::milliseconds build{};
+    std::chrono::milliseconds copy{};
+    std::chrono::milliseconds traversal{};
+    // destruction of both catalogs and of the resource, which releases what the catalogs didn't deallocate
+    std::chrono::milliseconds teardown{};
+    size_t checksum = 0;
+  };
+
+  // builds a catalog of the named products, copies it and traverses the copy. Both catalogs allocate from the
+  // resource created by make_resource.
+  template<typename Product, typename MakeResource>
+  catalog_timings run_catalog_workload(const std::span<const std::string> names, MakeResource make_resource)
+  {
+    catalog_timings timings;
+    std::shared_ptr<std::pmr::memory_resource> resource;
+    std::unique_ptr<product_catalog<Product>> catalog;
+    std::unique_ptr<product_catalog<Product>> copy;
+
+    timings.build = measure([&] {
+      resource = make_resource();
+      catalog = std::make_unique<product_catalog<Product>>(resource.get());
+      catalog->reserve(names.size());
+      for (const auto& name : names)
+        catalog->add(name);
+    });
+
+    timings.copy = measure([&] { copy = std::make_unique<product_catalog<Product>>(*catalog, resource.get()); });
+    timings.traversal = measure([&] { timings.checksum = copy->checksum(); });
+
+    timings.teardown = measure([&] {
+      copy.reset();
+      catalog.reset();
+      resource.reset();
+    });
+
+    return timings;
+  }
+
+  // the median of each phase over several runs of the workload
+  template<typename Product, typename MakeResource>
+  catalog_timings median_catalog_timings(const std::span<const std::string> names, MakeResource make_resource)
+  {
+    static constexpr size_t num_runs = 5;
+
+    std::vector<catalog_timings> runs;
+    for (size_t i = 0; i < num_runs; ++i)
+      runs.push_back(run_catalog_workload<Product>(names, make_resource));
+
+    const auto median = [&](std::chrono::milliseconds catalog_timings::*phase) {
+      std::ranges::nth_element(runs, runs.begin() + num_runs / 2, {}, phase);
+      return runs[num_runs / 2].*phase;
+    };
+
+    return {.build = median(&catalog_timings::build),
+            .copy = median(&catalog_timings::copy),
+            .traversal = median(&catalog_timings::traversal),
+            .teardown = median(&catalog_timings::teardown),
+            .checksum = runs.front().checksum};
+  }
+
+  template<typename Product, typename MakeResource>
+  size_t report_catalog_workload(const char* const product_name, const char* const resource_name,
+                                 MakeResource make_resource, const std::span<const std::string> names)
+  {
+    const auto timings = median_catalog_timings<Product>(names, make_resource);
+    std::cout << "  " << product_name << " on " << resource_name << ": build " << timings.build << ", copy "
+              << timings.copy << ", traversal " << timings.traversal << ", teardown " << timings.teardown << '\n';
+
+    return timings.checksum;
+  }
+
+  template<typename MakeResource>
+  void report_catalog_workloads(const char* const resource_name, MakeResource make_resource,
+                                const std::span<const std::string> names, std::vector<size_t>& checksums)
+  {
+    checksums.push_back(report_catalog_workload<product>("product", resource_name, make_resource, names));
+    checksums.push_back(report_catalog_workload<product_pmr_alloc_aware>("product_pmr_alloc_aware", resource_name,
+                                                                         make_resource, names));
+  }
 }  // namespace
 
-int main()
+int main(int argc, char** argv)
 {
+  size_t num_products = 1'000'000;
+  if (argc > 1)
+  {
+    const std::string_view arg{argv[1]};
+    const auto [ptr, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), num_products);
+    if (ec != std::errc{} || ptr != arg.data() + arg.size())
+    {
+      std::cerr << "usage: allocator_aware_object [number of products]\n";
+      return EXIT_FAILURE;
+    }
+  }
+
   run<product>();
   // prints
   // #0________________________________________________________________________________________________________________________________
@@ -72,5 +251,20 @@ int main()
   //                                           ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
   // the storage of the string _is_ contained in the stack buffer
 
+  // the same catalog workload on each resource, the median of 5 runs is reported. The names of product are always
+  // allocated from the heap, the ones of product_pmr_alloc_aware from the resource of the catalog next to the vector
+  const auto names = generate_product_names(num_products);
+  std::vector<size_t> checksums;
+
+  std::cout << "\nbuilding, copying, traversing and destroying catalogs of " << num_products << " products\n";
+  report_catalog_workloads("std::pmr::new_delete_resource()", make_heap_resource, names, checksums);
+  report_catalog_workloads("std::pmr::unsynchronized_pool_resource",
+                           make_resource_on_heap<std::pmr::unsynchronized_pool_resource>, names, checksums);
+  report_catalog_workloads("std::pmr::monotonic_buffer_resource",
+                           make_resource_on_heap<std::pmr::monotonic_buffer_resource>, names, checksums);
+
+  if (std::ranges::adjacent_find(checksums, std::ranges::not_equal_to{}) != checksums.end())
+    std::cout << "the traversals of the catalogs DIFFER\n";
+
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,181 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <ostream>
+#include <string_view>
+
+namespace quxflux::benchmark
+{
+  namespace
+  {
+    // counters are mostly counts, print them without a fractional part if they don't have one
+    void write_value(std::ostream& os, const double value)
+    {
+      if (value == std::trunc(value) && std::abs(value) < 1e15)
+        os << static_cast<long long>(value);
+      else
+        os << value;
+    }
+
+    void write_value(std::ostream& os, const std::string& value) { os << value; }
+
+    template<typename List>
+    void write_key_value_pairs(std::ostream& os, const List& list)
+    {
+      for (size_t i = 0; i < list.size(); ++i)
+      {
+        os << (i > 0 ? ";" : "") << list[i].first << '=';
+        write_value(os, list[i].second);
+      }
+    }
+
+    void write_json_string(std::ostream& os, const std::string_view str)
+    {
+      os << '"';
+      for (const auto c : str)
+      {
+        if (c == '"' || c == '\\')
+          os << '\\';
+        os << c;
+      }
+      os << '"';
+    }
+
+    void write_json_statistics(std::ostream& os, const sample_statistics& stats)
+    {
+      os << "{\"repetitions\": " << stats.repetitions << ", \"min\": " << stats.min << ", \"max\": " << stats.max
+         << ", \"mean\": " << stats.mean << ", \"median\": " << stats.median << ", \"p95\": " << stats.p95
+         << ", \"stddev\": " << stats.stddev << '}';
+    }
+
+    void write_csv(std::ostream& os, const std::span<const result> results)
+    {
+      os << "name,parameters,repetitions,min_ms,median_ms,p95_ms,mean_ms,stddev_ms,max_ms,counters\n";
+
+      for (const auto& r : results)
+      {
+        const auto& stats = r.wall_time_ms;
+
+        os << r.name << ',';
+        write_key_value_pairs(os, r.parameters);
+        os << ',' << stats.repetitions << ',' << stats.min << ',' << stats.median << ',' << stats.p95 << ','
+           << stats.mean << ',' << stats.stddev << ',' << stats.max << ',';
+        write_key_value_pairs(os, r.counters);
+        os << '\n';
+      }
+    }
+
+    void write_json(std::ostream& os, const std::span<const result> results)
+    {
+      os << "{\n  \"results\": [";
+
+      for (size_t i = 0; i < results.size(); ++i)
+      {
+        const auto& r = results[i];
+
+        os << (i > 0 ? ",\n" : "\n") << "    {\"name\": ";
+        write_json_string(os, r.name);
+
+        os << ", \"parameters\": {";
+        for (size_t j = 0; j < r.parameters.size(); ++j)
+        {
+          os << (j > 0 ? ", " : "");
+          write_json_string(os, r.parameters[j].first);
+          os << ": ";
+          write_json_string(os, r.parameters[j].second);
+        }
+
+        os << "}, \"wall_time_ms\": ";
+        write_json_statistics(os, r.wall_time_ms);
+
+        os << ", \"counters\": {";
+        for (size_t j = 0; j < r.counters.size(); ++j)
+        {
+          os << (j > 0 ? ", " : "");
+          write_json_string(os, r.counters[j].first);
+          os << ": ";
+          write_value(os, r.counters[j].second);
+        }
+        os << "}}";
+      }
+
+      os << "\n  ]\n}\n";
+    }
+  }  // namespace
+
+  sample_statistics summarize(std::vector<double> samples)
+  {
+    sample_statistics stats;
+    stats.repetitions = samples.size();
+
+    if (samples.empty())
+      return stats;
+
+    std::ranges::sort(samples);
+
+    const auto n = samples.size();
+    const auto at_rank = [&](const double fraction) {
+      const auto rank = static_cast<size_t>(std::ceil(fraction * static_cast<double>(n)));
+      return samples[std::clamp<size_t>(rank, 1, n) - 1];
+    };
+
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.median = n % 2 == 1 ? samples[n / 2] : std::midpoint(samples[n / 2 - 1], samples[n / 2]);
+    stats.p95 = at_rank(0.95);
+    stats.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(n);
+
+    if (n > 1)
+    {
+      const auto sum_of_squares =
+        std::accumulate(samples.begin(), samples.end(), 0.0,
+                        [&](const double acc, const double x) { return acc + (x - stats.mean) * (x - stats.mean); });
+      stats.stddev = std::sqrt(sum_of_squares / static_cast<double>(n - 1));
+    }
+
+    return stats;
+  }
+
+  void write_results(std::ostream& os, const std::span<const result> results, const output_format format)
+  {
+    const auto old_flags = os.flags();
+    const auto old_precision = os.precision();
+    os.setf(std::ios_base::fixed, std::ios_base::floatfield);
+    os.precision(3);
+
+    if (format == output_format::csv)
+      write_csv(os, results);
+    else
+      write_json(os, results);
+
+    os.flags(old_flags);
+    os.precision(old_precision);
+  }
+
+  void write_summary(std::ostream& os, const result& result)
+  {
+    const auto old_flags = os.flags();
+    const auto old_precision = os.precision();
+    os.setf(std::ios_base::fixed, std::ios_base::floatfield);
+    os.precision(2);
+
+    os << result.name << " [";
+    write_key_value_pairs(os, result.parameters);
+    os << "]: median " << result.wall_time_ms.median << " ms, p95 " << result.wall_time_ms.p95 << " ms, stddev "
+       << result.wall_time_ms.stddev << " ms";
+
+    if (!result.counters.empty())
+    {
+      os << " (";
+      write_key_value_pairs(os, result.counters);
+      os << ')';
+    }
+
+    os << '\n';
+
+    os.flags(old_flags);
+    os.precision(old_precision);
+  }
+}  // namespace quxflux::benchmark
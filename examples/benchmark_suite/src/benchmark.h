@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace quxflux::benchmark
+{
+  struct sample_statistics
+  {
+    size_t repetitions = 0;
+    double min = 0;
+    double max = 0;
+    double mean = 0;
+    double median = 0;
+    // nearest-rank 95th percentile
+    double p95 = 0;
+    // sample standard deviation, 0 for less than two samples
+    double stddev = 0;
+  };
+
+  sample_statistics summarize(std::vector<double> samples);
+
+  using parameter_list = std::vector<std::pair<std::string, std::string>>;
+  using counter_list = std::vector<std::pair<std::string, double>>;
+
+  struct result
+  {
+    std::string name;
+    // the inputs the benchmark was run with, e.g. the mesh size or the number of threads
+    parameter_list parameters;
+    // wall time of a single repetition in milliseconds
+    sample_statistics wall_time_ms;
+    // additional per-repetition measurements which don't vary between repetitions, e.g. allocation counts
+    counter_list counters;
+  };
+
+  struct run_options
+  {
+    size_t warmup = 1;
+    size_t repetitions = 5;
+  };
+
+  // invokes run(setup()) warmup + repetitions times and summarizes the wall time of the last repetitions runs.
+  // setup() is invoked before each run and is excluded from the measurement, which allows to hand each run a
+  // fresh copy of its input.
+  template<typename Setup, typename Run>
+  sample_statistics measure(const run_options& options, Setup&& setup, Run&& run)
+  {
+    std::vector<double> samples;
+    samples.reserve(options.repetitions);
+
+    for (size_t i = 0; i < options.warmup + options.repetitions; ++i)
+    {
+      auto input = setup();
+
+      const auto start = std::chrono::steady_clock::now();
+      run(input);
+      const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+      if (i >= options.warmup)
+        samples.push_back(elapsed.count());
+    }
+
+    return summarize(std::move(samples));
+  }
+
+  template<typename Run>
+  sample_statistics measure(const run_options& options, Run&& run)
+  {
+    return measure(
+      options, [] { return 0; }, [&](int) { run(); });
+  }
+
+  enum class output_format
+  {
+    csv,
+    json
+  };
+
+  // writes one row (csv) or object (json) per result. The csv format joins parameters and counters into single
+  // columns of semicolon separated key=value pairs, so that all rows share the same header.
+  void write_results(std::ostream& os, std::span<const result> results, output_format format);
+
+  // writes a short human readable summary of a single result
+  void write_summary(std::ostream& os, const result& result);
+}  // namespace quxflux::benchmark
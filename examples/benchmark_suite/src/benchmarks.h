@@ -0,0 +1,48 @@
+#pragma once
+
+#include "benchmark.h"
+
+#include <parallel.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace quxflux::benchmark
+{
+  struct suite_config
+  {
+    run_options run;
+    std::vector<size_t> subdivision_levels{5, 6, 7, 8};
+    std::vector<size_t> iteration_counts{1, 10};
+    // 0 selects std::thread::hardware_concurrency()
+    std::vector<size_t> thread_counts{1, 0};
+    // displacement tolerances of the convergence-driven smoothing benchmarks
+    std::vector<float> displacement_tolerances{1e-4f};
+    // only benchmarks whose name contains this string are run
+    std::string filter;
+
+    bool selected(const std::string_view name) const { return name.find(filter) != std::string_view::npos; }
+  };
+
+  // several requested thread counts may resolve to the same number of threads, e.g. 0 on a single core machine
+  inline std::vector<size_t> resolved_thread_counts(const suite_config& config)
+  {
+    std::vector<size_t> thread_counts;
+    std::ranges::transform(config.thread_counts, std::back_inserter(thread_counts), &detail::resolve_num_threads);
+    std::ranges::sort(thread_counts);
+    const auto [last, end] = std::ranges::unique(thread_counts);
+    thread_counts.erase(last, end);
+
+    return thread_counts;
+  }
+
+  using result_sink = std::function<void(result)>;
+
+  void run_smoothing_benchmarks(const suite_config& config, const result_sink& sink);
+  void run_memory_resource_benchmarks(const suite_config& config, const result_sink& sink);
+}  // namespace quxflux::benchmark
@@ -0,0 +1,154 @@
+#include "benchmark.h"
+#include "benchmarks.h"
+
+#include <charconv>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+  namespace qb = quxflux::benchmark;
+
+  constexpr std::string_view usage = R"(usage: benchmark_suite [options]
+
+options:
+  --format=csv|json         output format (default: csv)
+  --output=<path>           write the results to <path> instead of stdout
+  --warmup=<n>              untimed runs before the measurement (default: 1)
+  --repetitions=<n>         timed runs per benchmark (default: 5)
+  --subdivisions=<n,...>    subdivision levels of the smoothed spheres (default: 5,6,7,8)
+  --iterations=<n,...>      smoothing iteration counts (default: 1,10)
+  --threads=<n,...>         smoothing thread counts, 0 selects all hardware threads (default: 1,0)
+  --tolerances=<x,...>      displacement tolerances of the convergence-driven smoothing (default: 0.0001)
+  --filter=<substring>      only run benchmarks whose name contains <substring>
+)";
+
+  template<typename T>
+  T parse_number(const std::string_view str)
+  {
+    T value{};
+    const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+
+    if (ec != std::errc{} || ptr != str.data() + str.size() || value < T{0})
+      throw std::invalid_argument("expected a non-negative number, got '" + std::string{str} + "'");
+
+    return value;
+  }
+
+  template<typename T>
+  std::vector<T> parse_list(std::string_view str)
+  {
+    std::vector<T> values;
+
+    while (true)
+    {
+      const auto separator = str.find(',');
+      values.push_back(parse_number<T>(str.substr(0, separator)));
+
+      if (separator == std::string_view::npos)
+        return values;
+
+      str.remove_prefix(separator + 1);
+    }
+  }
+
+  struct command_line
+  {
+    qb::suite_config config;
+    qb::output_format format = qb::output_format::csv;
+    std::optional<std::string> output_path;
+  };
+
+  command_line parse_command_line(const int argc, char** argv)
+  {
+    command_line cl;
+
+    for (int i = 1; i < argc; ++i)
+    {
+      const std::string_view arg{argv[i]};
+      const auto separator = arg.find('=');
+
+      if (!arg.starts_with("--") || separator == std::string_view::npos)
+        throw std::invalid_argument("invalid argument '" + std::string{arg} + "'");
+
+      const auto key = arg.substr(2, separator - 2);
+      const auto value = arg.substr(separator + 1);
+
+      if (key == "format")
+      {
+        if (value != "csv" && value != "json")
+          throw std::invalid_argument("unknown output format '" + std::string{value} + "'");
+
+        cl.format = value == "csv" ? qb::output_format::csv : qb::output_format::json;
+      } else if (key == "output")
+        cl.output_path = std::string{value};
+      else if (key == "warmup")
+        cl.config.run.warmup = parse_number<size_t>(value);
+      else if (key == "repetitions")
+        cl.config.run.repetitions = parse_number<size_t>(value);
+      else if (key == "subdivisions")
+        cl.config.subdivision_levels = parse_list<size_t>(value);
+      else if (key == "iterations")
+        cl.config.iteration_counts = parse_list<size_t>(value);
+      else if (key == "threads")
+        cl.config.thread_counts = parse_list<size_t>(value);
+      else if (key == "tolerances")
+        cl.config.displacement_tolerances = parse_list<float>(value);
+      else if (key == "filter")
+        cl.config.filter = std::string{value};
+      else
+        throw std::invalid_argument("unknown option '" + std::string{key} + "'");
+    }
+
+    if (cl.config.run.repetitions == 0)
+      throw std::invalid_argument("at least one repetition is required");
+
+    return cl;
+  }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  command_line cl;
+
+  try
+  {
+    cl = parse_command_line(argc, argv);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << "\n\n" << usage;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<qb::result> results;
+
+  // progress is reported on stderr, so stdout only contains the machine readable results
+  const qb::result_sink sink = [&](qb::result r) {
+    qb::write_summary(std::cerr, r);
+    results.push_back(std::move(r));
+  };
+
+  qb::run_smoothing_benchmarks(cl.config, sink);
+  qb::run_memory_resource_benchmarks(cl.config, sink);
+
+  if (cl.output_path)
+  {
+    std::ofstream ofs;
+    ofs.exceptions(std::ios_base::failbit);
+    ofs.open(*cl.output_path);
+    qb::write_results(ofs, results, cl.format);
+  } else
+  {
+    qb::write_results(std::cout, results, cl.format);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,255 @@
+#include "benchmarks.h"
+
+#include <forwarding_mem_resource.h>
+#include <laplacian_smoothing.h>
+#include <map_workload.h>
+#include <pool_tuning.h>
+#include <recording_mem_resource.h>
+#include <thread_caching_pool_resource.h>
+#include <trace_replay.h>
+#include <tracking_mem_resource.h>
+#include <tri_mesh.h>
+
+#include <functional>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace quxflux::benchmark
+{
+  namespace
+  {
+    counter_list upstream_counters(const tracking_mem_resource::statistics& upstream_statistics)
+    {
+      return {{"upstream_allocations", static_cast<double>(upstream_statistics.n_allocations)},
+              {"upstream_bytes", static_cast<double>(upstream_statistics.n_bytes_allocated)},
+              {upstream_statistics.peak_is_upper_bound ? "upstream_peak_bytes_upper_bound" : "upstream_peak_bytes",
+               static_cast<double>(upstream_statistics.peak_bytes_in_use)}};
+    }
+
+    // runs the map workload of mem_resource_chaining on the resource created by make_resource(upstream), the
+    // counters report the requests which reached the upstream resource
+    template<typename MakeResource>
+    void run_map_workload(const suite_config& config, const result_sink& sink, const std::string& name,
+                          MakeResource make_resource)
+    {
+      if (!config.selected(name))
+        return;
+
+      tracking_mem_resource::statistics upstream_statistics;
+
+      const auto stats = measure(config.run, [&] {
+        tracking_mem_resource upstream;
+        {
+          auto resource = make_resource(&upstream);
+          perform_deterministic_random_map_ops(&resource);
+        }
+        upstream_statistics = upstream.get_statistics();
+      });
+
+      sink({.name = name, .parameters = {}, .wall_time_ms = stats, .counters = upstream_counters(upstream_statistics)});
+    }
+
+    // runs the map workload on each of the thread counts concurrently, all threads sharing the resource. Without
+    // count_upstream the resource is created on top of std::pmr::new_delete_resource() and no counters are reported:
+    // counting every request of a resource which forwards all of them would bias the measurement. The threads free
+    // each other's blocks, so the upstream peak is tracked exactly.
+    template<typename MakeResource>
+    void run_concurrent_map_workload(const suite_config& config, const result_sink& sink, const std::string& name,
+                                     MakeResource make_resource, const bool count_upstream = true)
+    {
+      if (!config.selected(name))
+        return;
+
+      for (const auto num_threads : resolved_thread_counts(config))
+      {
+        tracking_mem_resource::statistics upstream_statistics;
+
+        const auto stats = measure(config.run, [&] {
+          tracking_mem_resource upstream{std::pmr::new_delete_resource(), tracking_mem_resource::peak_tracking::exact};
+          {
+            auto resource = make_resource(count_upstream ? &upstream : std::pmr::new_delete_resource());
+            perform_deterministic_random_map_ops_concurrently(&resource, num_threads);
+          }
+          upstream_statistics = upstream.get_statistics();
+        });
+
+        sink({.name = name,
+              .parameters = {{"threads", std::to_string(num_threads)}},
+              .wall_time_ms = stats,
+              .counters = count_upstream ? upstream_counters(upstream_statistics) : counter_list{}});
+      }
+    }
+
+    // an unsynchronized_pool_resource whose chunks are carved from a monotonic_buffer_resource
+    class pool_on_monotonic_resource : public std::pmr::memory_resource
+    {
+    public:
+      explicit pool_on_monotonic_resource(std::pmr::memory_resource* upstream)
+        : monotonic_(upstream), pool_(&monotonic_)
+      {}
+
+    private:
+      void* do_allocate(size_t n_bytes, size_t alignment) final { return pool_.allocate(n_bytes, alignment); }
+
+      void do_deallocate(void* ptr, size_t n_bytes, size_t alignment) final
+      {
+        pool_.deallocate(ptr, n_bytes, alignment);
+      }
+
+      bool do_is_equal(const memory_resource& that) const noexcept final { return this == &that; }
+
+      std::pmr::monotonic_buffer_resource monotonic_;
+      std::pmr::unsynchronized_pool_resource pool_;
+    };
+
+    struct recorded_trace
+    {
+      parameter_list parameters;
+      allocation_trace trace;
+      // the requests of the trace as seen by a tracking_mem_resource, from which pool_options are tuned
+      tracking_mem_resource::statistics statistics;
+    };
+
+    // records the requests run(resource) performs on resource
+    template<typename Run>
+    recorded_trace record_trace(parameter_list parameters, Run run)
+    {
+      tracking_mem_resource tracking;
+      recording_mem_resource recorder{&tracking};
+      run(&recorder);
+
+      return {std::move(parameters), recorder.get_trace(), tracking.get_statistics()};
+    }
+
+    // the requests of the map workload, the generation of the spheres and their smoothing using use_pmr_vector
+    std::vector<recorded_trace> record_traces(const suite_config& config)
+    {
+      std::vector<recorded_trace> traces;
+
+      traces.push_back(record_trace({{"trace", "map_workload"}}, [](std::pmr::memory_resource* resource) {
+        perform_deterministic_random_map_ops(resource);
+      }));
+
+      for (const auto subdivision_level : config.subdivision_levels)
+      {
+        const parameter_list sphere_parameters{{"subdivision_level", std::to_string(subdivision_level)}};
+
+        traces.push_back(record_trace({{"trace", "mesh_generation"}, sphere_parameters.front()},
+                                      [&](std::pmr::memory_resource* resource) {
+                                        static_cast<void>(
+                                          generate_noisy_unit_sphere(subdivision_level, 0.01f, 1, resource));
+                                      }));
+
+        for (const auto iterations : config.iteration_counts)
+        {
+          const auto sphere = generate_noisy_unit_sphere(subdivision_level, 0.01f, 0);
+
+          traces.push_back(record_trace(
+            {{"trace", "smoothing"}, sphere_parameters.front(), {"iterations", std::to_string(iterations)}},
+            [&](std::pmr::memory_resource* resource) {
+              laplacian_smoothing(*sphere, iterations, allocation_strategy::use_pmr_vector,
+                                  {.upstream_resource = resource});
+            }));
+        }
+      }
+
+      return traces;
+    }
+
+    // replays the recorded traces on the resource created by make_resource(upstream) respectively
+    // make_resource(upstream, recorded_trace) for resources configured for the trace, the wall time includes the
+    // construction and destruction of the resource
+    template<typename MakeResource>
+    void run_trace_replays(const suite_config& config, const result_sink& sink, const std::string& name,
+                           const std::function<const std::vector<recorded_trace>&()>& traces,
+                           MakeResource make_resource)
+    {
+      if (!config.selected(name))
+        return;
+
+      for (const auto& recorded : traces())
+      {
+        replay_statistics replay_stats;
+
+        const auto stats = measure(config.run, [&] {
+          tracking_mem_resource upstream;
+          auto resource = [&] {
+            if constexpr (std::is_invocable_v<MakeResource, std::pmr::memory_resource*, const recorded_trace&>)
+              return make_resource(&upstream, recorded);
+            else
+              return make_resource(&upstream);
+          }();
+          replay_stats = replay_trace(recorded.trace, resource, upstream);
+        });
+
+        sink({.name = name,
+              .parameters = recorded.parameters,
+              .wall_time_ms = stats,
+              .counters = {{"requests", static_cast<double>(replay_stats.n_allocations + replay_stats.n_deallocations)},
+                           {"upstream_allocations", static_cast<double>(replay_stats.n_upstream_allocations)},
+                           {"upstream_peak_bytes", static_cast<double>(replay_stats.peak_upstream_bytes)},
+                           {"fragmentation", replay_stats.fragmentation()}}});
+      }
+    }
+  }  // namespace
+
+  void run_memory_resource_benchmarks(const suite_config& config, const result_sink& sink)
+  {
+    run_map_workload(config, sink, "map_workload/new_delete",
+                     [](std::pmr::memory_resource* upstream) { return forwarding_mem_resource{upstream}; });
+    run_map_workload(config, sink, "map_workload/unsynchronized_pool", [](std::pmr::memory_resource* upstream) {
+      return std::pmr::unsynchronized_pool_resource{upstream};
+    });
+    run_map_workload(config, sink, "map_workload/synchronized_pool", [](std::pmr::memory_resource* upstream) {
+      return std::pmr::synchronized_pool_resource{upstream};
+    });
+    run_map_workload(config, sink, "map_workload/monotonic", [](std::pmr::memory_resource* upstream) {
+      return std::pmr::monotonic_buffer_resource{upstream};
+    });
+    run_map_workload(config, sink, "map_workload/thread_caching_pool", [](std::pmr::memory_resource* upstream) {
+      return thread_caching_pool_resource{upstream};
+    });
+
+    // the thread-safe resources shared by several threads
+    run_concurrent_map_workload(
+      config, sink, "map_workload_concurrent/new_delete",
+      [](std::pmr::memory_resource* upstream) { return forwarding_mem_resource{upstream}; }, false);
+    run_concurrent_map_workload(config, sink, "map_workload_concurrent/synchronized_pool",
+                                [](std::pmr::memory_resource* upstream) {
+                                  return std::pmr::synchronized_pool_resource{upstream};
+                                });
+    run_concurrent_map_workload(config, sink, "map_workload_concurrent/thread_caching_pool",
+                                [](std::pmr::memory_resource* upstream) {
+                                  return thread_caching_pool_resource{upstream};
+                                });
+
+    // the traces are only recorded if a replay is selected
+    std::optional<std::vector<recorded_trace>> recorded_traces;
+    const auto traces = [&]() -> const std::vector<recorded_trace>& {
+      if (!recorded_traces)
+        recorded_traces = record_traces(config);
+      return *recorded_traces;
+    };
+
+    run_trace_replays(config, sink, "trace_replay/new_delete", traces,
+                      [](std::pmr::memory_resource* upstream) { return forwarding_mem_resource{upstream}; });
+    run_trace_replays(config, sink, "trace_replay/unsynchronized_pool", traces,
+                      [](std::pmr::memory_resource* upstream) {
+                        return std::pmr::unsynchronized_pool_resource{upstream};
+                      });
+    run_trace_replays(config, sink, "trace_replay/tuned_unsynchronized_pool", traces,
+                      [](std::pmr::memory_resource* upstream, const recorded_trace& recorded) {
+                        return make_tuned_pool_resource(recorded.statistics, upstream);
+                      });
+    run_trace_replays(config, sink, "trace_replay/monotonic", traces, [](std::pmr::memory_resource* upstream) {
+      return std::pmr::monotonic_buffer_resource{upstream};
+    });
+    run_trace_replays(config, sink, "trace_replay/unsynchronized_pool_on_monotonic", traces,
+                      [](std::pmr::memory_resource* upstream) { return pool_on_monotonic_resource{upstream}; });
+    run_trace_replays(config, sink, "trace_replay/thread_caching_pool", traces,
+                      [](std::pmr::memory_resource* upstream) { return thread_caching_pool_resource{upstream}; });
+  }
+}  // namespace quxflux::benchmark
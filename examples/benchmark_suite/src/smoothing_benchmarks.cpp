@@ -0,0 +1,312 @@
+#include "benchmarks.h"
+
+#include <blocked_smoothing.h>
+#include <laplacian_smoothing.h>
+#include <out_of_core_smoothing.h>
+#include <parallel.h>
+#include <tracking_mem_resource.h>
+#include <tri_mesh.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace quxflux::benchmark
+{
+  namespace
+  {
+    struct benchmark_mesh
+    {
+      std::unique_ptr<tri_mesh> mesh;
+      size_t subdivision_level = 0;
+      // "generated" for the order of generate_noisy_unit_sphere, "rcm" after reorder_vertices
+      std::string vertex_order;
+    };
+
+    const char* to_string(const vertex_buffering buffering)
+    {
+      return buffering == vertex_buffering::ping_pong ? "ping_pong" : "copy_per_iteration";
+    }
+
+    template<typename Strategy>
+    void run_strategy(const suite_config& config, const result_sink& sink, const std::string& name,
+                      const Strategy& strategy, const benchmark_mesh& input,
+                      const vertex_buffering buffering = vertex_buffering::ping_pong,
+                      const parameter_list& strategy_parameters = {})
+    {
+      const auto& mesh = *input.mesh;
+
+      if (!config.selected(name))
+        return;
+
+      for (const auto iterations : config.iteration_counts)
+      {
+        for (const auto num_threads : resolved_thread_counts(config))
+        {
+          // the allocations from the upstream resource and the spills are averaged over all runs
+          tracking_mem_resource upstream;
+          size_t num_spills = 0;
+          size_t num_runs = 0;
+
+          const auto stats = measure(
+            config.run, [&] { return mesh.clone(); },
+            [&](const std::unique_ptr<tri_mesh>& copy) {
+              ++num_runs;
+              laplacian_smoothing(
+                *copy, iterations, strategy,
+                {.num_threads = num_threads,
+                 .buffering = buffering,
+                 .on_iteration = [&](const smoothing_iteration_statistics& s) { num_spills += s.num_spills; },
+                 .upstream_resource = &upstream});
+            });
+
+          const auto per_run = [&](const size_t count) {
+            return static_cast<double>(count) / static_cast<double>(std::max<size_t>(num_runs, 1));
+          };
+
+          parameter_list parameters{{"subdivision_level", std::to_string(input.subdivision_level)},
+                                    {"num_vertices", std::to_string(mesh.get_num_vertices())},
+                                    {"vertex_order", input.vertex_order},
+                                    {"index_bits", std::to_string(8 * sizeof(vertex_index))},
+                                    {"iterations", std::to_string(iterations)},
+                                    {"threads", std::to_string(num_threads)},
+                                    {"buffering", to_string(buffering)}};
+          parameters.insert(parameters.end(), strategy_parameters.begin(), strategy_parameters.end());
+
+          // the share of the smoothed vertices whose neighbor buffer spilled
+          const auto num_vertex_updates = std::max<size_t>(iterations * mesh.get_num_vertices(), 1);
+
+          sink({.name = name,
+                .parameters = std::move(parameters),
+                .wall_time_ms = stats,
+                .counters = {{"upstream_allocations", per_run(upstream.get_statistics().n_allocations)},
+                             {"spills", per_run(num_spills)},
+                             {"spill_rate", per_run(num_spills) / static_cast<double>(num_vertex_updates)}}});
+        }
+      }
+    }
+
+    template<typename Strategy>
+    void run_converging_strategy(const suite_config& config, const result_sink& sink, const std::string& name,
+                                 const Strategy& strategy, const benchmark_mesh& input)
+    {
+      if (!config.selected(name))
+        return;
+
+      const auto& mesh = *input.mesh;
+
+      for (const auto max_iterations : config.iteration_counts)
+      {
+        for (const auto tolerance : config.displacement_tolerances)
+        {
+          size_t num_iterations = 0;
+          size_t num_vertex_updates = 0;
+
+          const auto stats = measure(
+            config.run, [&] { return mesh.clone(); },
+            [&](const std::unique_ptr<tri_mesh>& copy) {
+              num_iterations = 0;
+              num_vertex_updates = 0;
+
+              laplacian_smoothing(*copy, max_iterations, strategy,
+                                  {.displacement_tolerance = tolerance,
+                                   .on_iteration = [&](const smoothing_iteration_statistics& iteration_stats) {
+                                     ++num_iterations;
+                                     num_vertex_updates += iteration_stats.num_active_vertices;
+                                   }});
+            });
+
+          sink({.name = name,
+                .parameters = {{"subdivision_level", std::to_string(input.subdivision_level)},
+                               {"num_vertices", std::to_string(mesh.get_num_vertices())},
+                               {"vertex_order", input.vertex_order},
+                               {"max_iterations", std::to_string(max_iterations)},
+                               {"tolerance", std::to_string(tolerance)}},
+                .wall_time_ms = stats,
+                .counters = {{"iterations", static_cast<double>(num_iterations)},
+                             {"vertex_updates", static_cast<double>(num_vertex_updates)}}});
+        }
+      }
+    }
+
+    void run_out_of_core(const suite_config& config, const result_sink& sink, const benchmark_mesh& input)
+    {
+      static constexpr auto name = "smoothing/out_of_core";
+      static constexpr size_t memory_limit = size_t{32} << 20;
+
+      if (!config.selected(name))
+        return;
+
+      const auto input_path = std::filesystem::temp_directory_path() / "benchmark_suite_out_of_core_input.bin";
+      const auto output_path = std::filesystem::temp_directory_path() / "benchmark_suite_out_of_core_output.bin";
+      write_binary(*input.mesh, input_path);
+
+      for (const auto iterations : config.iteration_counts)
+      {
+        out_of_core_statistics ooc_stats;
+        const auto stats = measure(config.run, [&] {
+          ooc_stats =
+            laplacian_smoothing_out_of_core(input_path, output_path, iterations, {.memory_limit = memory_limit});
+        });
+
+        const auto num_loaded = ooc_stats.num_passes * input.mesh->get_num_vertices();
+
+        sink({.name = name,
+              .parameters = {{"subdivision_level", std::to_string(input.subdivision_level)},
+                             {"num_vertices", std::to_string(input.mesh->get_num_vertices())},
+                             {"vertex_order", input.vertex_order},
+                             {"iterations", std::to_string(iterations)},
+                             {"memory_limit_mib", std::to_string(memory_limit >> 20)}},
+              .wall_time_ms = stats,
+              .counters = {{"chunks", static_cast<double>(ooc_stats.num_chunks)},
+                           {"halo_ratio", static_cast<double>(ooc_stats.num_halo_vertices) /
+                                            static_cast<double>(std::max<size_t>(num_loaded, 1))},
+                           {"mib_read", static_cast<double>(ooc_stats.num_bytes_read) / (1024 * 1024)},
+                           {"peak_buffer_mib", static_cast<double>(ooc_stats.peak_buffer_bytes) / (1024 * 1024)}}});
+      }
+
+      std::filesystem::remove(input_path);
+      std::filesystem::remove(output_path);
+    }
+  }  // namespace
+
+  void run_smoothing_benchmarks(const suite_config& config, const result_sink& sink)
+  {
+    for (const auto subdivision_level : config.subdivision_levels)
+    {
+      if (config.selected("mesh/generate_noisy_unit_sphere"))
+      {
+        for (const auto num_threads : resolved_thread_counts(config))
+        {
+          const auto stats =
+            measure(config.run, [&] { generate_noisy_unit_sphere(subdivision_level, 0.01f, num_threads); });
+
+          sink({.name = "mesh/generate_noisy_unit_sphere",
+                .parameters = {{"subdivision_level", std::to_string(subdivision_level)},
+                               {"threads", std::to_string(num_threads)}},
+                .wall_time_ms = stats,
+                .counters = {}});
+        }
+      }
+
+      const auto sphere = generate_noisy_unit_sphere(subdivision_level, 0.01f, 0);
+
+      if (config.selected("mesh/clone"))
+      {
+        // a clone and its destruction, either allocating each vector from the default resource or the whole mesh
+        // from an arena which is sized to hold it
+        tracking_mem_resource sizing;
+        static_cast<void>(sphere->clone(&sizing));
+        const auto mesh_size = sizing.get_statistics().n_bytes_allocated + 4 * alignof(std::max_align_t);
+
+        for (const auto use_arena : {false, true})
+        {
+          tracking_mem_resource upstream;
+          size_t num_runs = 0;
+
+          const auto stats = measure(config.run, [&] {
+            ++num_runs;
+
+            if (use_arena)
+            {
+              std::pmr::monotonic_buffer_resource arena{mesh_size, &upstream};
+              static_cast<void>(sphere->clone(&arena));
+            }
+            else
+            {
+              static_cast<void>(sphere->clone(&upstream));
+            }
+          });
+
+          sink({.name = "mesh/clone",
+                .parameters = {{"subdivision_level", std::to_string(subdivision_level)},
+                               {"resource", use_arena ? "arena" : "default"}},
+                .wall_time_ms = stats,
+                .counters = {{"upstream_allocations", static_cast<double>(upstream.get_statistics().n_allocations) /
+                                                        static_cast<double>(std::max<size_t>(num_runs, 1))}}});
+        }
+      }
+
+      if (config.selected("mesh/reorder_vertices"))
+      {
+        const auto stats = measure(
+          config.run, [&] { return sphere->clone(); },
+          [](const std::unique_ptr<tri_mesh>& copy) { reorder_vertices(*copy); });
+
+        sink({.name = "mesh/reorder_vertices",
+              .parameters = {{"subdivision_level", std::to_string(subdivision_level)}},
+              .wall_time_ms = stats,
+              .counters = {}});
+      }
+
+      if (config.selected("mesh/smoothing_tiles"))
+      {
+        // the one-time cost of smoothing_kernel::temporally_blocked, which caches the tiles with the adjacency
+        const smoothing_kernel::detail::temporally_blocked_t kernel;
+        const auto adjacency = *sphere->adjacency();
+
+        for (const auto num_threads : resolved_thread_counts(config))
+        {
+          const auto stats = measure(config.run, [&] {
+            static_cast<void>(detail::make_smoothing_tiles(adjacency, sphere->get_num_vertices(), kernel.tile_size,
+                                                           kernel.iterations_per_pass, num_threads));
+          });
+
+          sink({.name = "mesh/smoothing_tiles",
+                .parameters = {{"subdivision_level", std::to_string(subdivision_level)},
+                               {"threads", std::to_string(num_threads)}},
+                .wall_time_ms = stats,
+                .counters = {}});
+        }
+      }
+
+      // the strategies are run on the mesh as generated and after reordering its vertices to report the speedup
+      // of the improved locality
+      std::array<benchmark_mesh, 2> meshes{benchmark_mesh{sphere->clone(), subdivision_level, "generated"},
+                                           benchmark_mesh{sphere->clone(), subdivision_level, "rcm"}};
+      reorder_vertices(*meshes[1].mesh);
+      // renumbering invalidates the adjacency, rebuild it once instead of in every measured copy
+      static_cast<void>(meshes[1].mesh->adjacency());
+
+      for (const auto& input : meshes)
+      {
+        run_strategy(config, sink, "smoothing/use_vector", allocation_strategy::use_vector, input);
+        run_strategy(config, sink, "smoothing/use_pmr_vector", allocation_strategy::use_pmr_vector, input);
+
+        // every inline buffer capacity, the one selected from the valence histogram of the mesh is marked
+        const auto selected_capacity =
+          allocation_strategy::select_inline_buffer_capacity(vertex_valence_histogram(*input.mesh));
+        for (const auto capacity : allocation_strategy::inline_buffer_capacities)
+        {
+          allocation_strategy::visit_inline_buffer(capacity, [&](const auto& strategy) {
+            run_strategy(config, sink, "smoothing/use_inline_buffer", strategy, input, vertex_buffering::ping_pong,
+                         {{"capacity", std::to_string(capacity)},
+                          {"selected", capacity == selected_capacity ? "yes" : "no"}});
+          });
+        }
+
+        run_strategy(config, sink, "smoothing/use_arena", allocation_strategy::use_arena, input);
+        run_strategy(config, sink, "smoothing/use_mesh_view", allocation_strategy::use_mesh_view, input);
+        run_strategy(config, sink, "smoothing/soa_simd_scalar",
+                     smoothing_kernel::detail::soa_simd_t{simd_instruction_set::scalar}, input);
+        run_strategy(config, sink, "smoothing/soa_simd", smoothing_kernel::soa_simd, input);
+        // the copies share the tiles cached by the warmup runs, mesh/smoothing_tiles reports the cost of building them
+        run_strategy(config, sink, "smoothing/temporally_blocked", smoothing_kernel::temporally_blocked, input,
+                     vertex_buffering::ping_pong, {{"tiles", "cached"}});
+        run_strategy(config, sink, "smoothing_copy_per_iteration/use_mesh_view", allocation_strategy::use_mesh_view,
+                     input, vertex_buffering::copy_per_iteration);
+        run_strategy(config, sink, "smoothing_copy_per_iteration/soa_simd", smoothing_kernel::soa_simd, input,
+                     vertex_buffering::copy_per_iteration);
+        run_converging_strategy(config, sink, "converging_smoothing/use_mesh_view", allocation_strategy::use_mesh_view,
+                                input);
+        run_out_of_core(config, sink, input);
+      }
+    }
+  }
+}  // namespace quxflux::benchmark
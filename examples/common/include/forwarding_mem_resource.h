@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace quxflux
+{
+  // forwards all requests to an upstream resource without recording anything, a baseline which costs no more than
+  // calling the upstream resource directly
+  class forwarding_mem_resource : public std::pmr::memory_resource
+  {
+  public:
+    explicit forwarding_mem_resource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+      : upstream_(upstream)
+    {}
+
+    std::pmr::memory_resource* upstream_resource() const { return upstream_; }
+
+  private:
+    void* do_allocate(const size_t n_bytes, const size_t alignment) final
+    {
+      return upstream_->allocate(n_bytes, alignment);
+    }
+
+    void do_deallocate(void* const ptr, const size_t n_bytes, const size_t alignment) final
+    {
+      upstream_->deallocate(ptr, n_bytes, alignment);
+    }
+
+    bool do_is_equal(const memory_resource& that) const noexcept final { return this == &that; }
+
+    std::pmr::memory_resource* upstream_;
+  };
+}  // namespace quxflux
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+namespace quxflux
+{
+  struct global_allocation_counts
+  {
+    size_t n_allocations = 0;
+    size_t n_bytes_allocated = 0;
+  };
+
+  // number of allocations served by the replaceable global operator new (including the array, aligned and nothrow
+  // versions) since the start of the program. Only available in executables which link pmr_example_counting_new,
+  // which defines QUXFLUX_COUNTING_OPERATOR_NEW.
+  global_allocation_counts get_global_allocation_counts();
+}  // namespace quxflux
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+
+namespace quxflux
+{
+  // bump allocates from a buffer of N bytes embedded in the resource itself, so a resource living on the stack
+  // serves small requests without touching the heap. Requests which don't fit into the rest of the buffer are
+  // passed to the upstream resource (they spill), which is counted as well as the requests served from the buffer
+  // (the hits). Like std::pmr::monotonic_buffer_resource deallocating a block from the buffer doesn't make its
+  // memory available again, release() rewinds the buffer. Not thread-safe.
+  template<size_t N>
+  class inline_buffer_resource : public std::pmr::memory_resource
+  {
+    static_assert(N > 0);
+
+  public:
+    explicit inline_buffer_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+      : upstream_(upstream)
+    {}
+
+    inline_buffer_resource(const inline_buffer_resource&) = delete;
+    inline_buffer_resource& operator=(const inline_buffer_resource&) = delete;
+
+    static constexpr size_t capacity() { return N; }
+
+    std::pmr::memory_resource* upstream_resource() const { return upstream_; }
+    size_t num_hits() const { return num_hits_; }
+    size_t num_spills() const { return num_spills_; }
+
+    // makes the whole buffer available again, none of the blocks allocated from it may be in use anymore. The
+    // blocks which spilled are unaffected, they are deallocated from upstream individually.
+    void release() { used_ = 0; }
+
+  private:
+    void* do_allocate(const size_t n_bytes, const size_t alignment) final
+    {
+      void* ptr = buffer_ + used_;
+      size_t space = N - used_;
+
+      // a block of 0 bytes at the end of the buffer would be mistaken for a spilled one when deallocated
+      if (std::align(alignment, n_bytes, ptr, space) && space > 0)
+      {
+        used_ = N - space + n_bytes;
+        ++num_hits_;
+        return ptr;
+      }
+
+      ++num_spills_;
+      return upstream_->allocate(n_bytes, alignment);
+    }
+
+    void do_deallocate(void* const ptr, const size_t n_bytes, const size_t alignment) final
+    {
+      if (!owns(ptr))
+        upstream_->deallocate(ptr, n_bytes, alignment);
+    }
+
+    bool do_is_equal(const memory_resource& that) const noexcept final { return this == &that; }
+
+    bool owns(const void* const ptr) const
+    {
+      // compared as integers, comparing pointers into different objects is unspecified
+      const auto p = reinterpret_cast<std::uintptr_t>(ptr);
+      const auto begin = reinterpret_cast<std::uintptr_t>(buffer_);
+      return p >= begin && p < begin + N;
+    }
+
+    alignas(std::max_align_t) std::byte buffer_[N];
+    size_t used_ = 0;
+    std::pmr::memory_resource* upstream_;
+    size_t num_hits_ = 0;
+    size_t num_spills_ = 0;
+  };
+}  // namespace quxflux
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <barrier>
+#include <cstddef>
+#include <iterator>
+#include <memory_resource>
+#include <optional>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace quxflux
+{
+  struct map_workload_result
+  {
+    size_t n_inserted = 0;
+    size_t n_erased = 0;
+  };
+
+  using workload_map = std::pmr::unordered_map<size_t, std::pair<size_t, float>>;
+
+  // performs the same insertions and deletions in map on each invocation
+  inline map_workload_result perform_deterministic_random_map_ops(workload_map& map)
+  {
+    std::mt19937 rd{42};
+
+    map_workload_result result;
+
+    for (size_t i = 0, n_operations = std::uniform_int_distribution<size_t>{1000, 1000000}(rd); i < n_operations; ++i)
+    {
+      // 50% chance to insert a new element
+      const auto delete_item = std::uniform_int_distribution<int>{0, 1}(rd) == 0;
+
+      if (delete_item && !map.empty())
+      {
+        auto it = map.begin();
+        std::advance(it, std::uniform_int_distribution<size_t>{0, map.size() - 1}(rd));
+        map.erase(it);
+        ++result.n_erased;
+      } else
+      {
+        const auto key = std::uniform_int_distribution<size_t>{}(rd);
+        const auto value = std::pair{std::uniform_int_distribution<size_t>{}(rd),
+                                     std::uniform_real_distribution<float>{}(rd)};
+
+        const bool did_insert = map.insert(std::pair{key, value}).second;
+        result.n_inserted += did_insert;
+      }
+    }
+
+    return result;
+  }
+
+  // this function performs the same insertions and deletions in an unordered_map on each
+  // invocation. A memory resource has to be passed which provided the unordered_map with
+  // memory.
+  inline map_workload_result perform_deterministic_random_map_ops(std::pmr::memory_resource* resource)
+  {
+    workload_map map{resource};
+    return perform_deterministic_random_map_ops(map);
+  }
+
+  // performs the map operations on num_threads threads concurrently, each on a map of its own but all of them
+  // allocating from resource, which therefore has to be thread-safe. Afterwards each map is destroyed by the next
+  // thread, so that its remaining nodes are deallocated by another thread than the one which allocated them.
+  inline map_workload_result perform_deterministic_random_map_ops_concurrently(std::pmr::memory_resource* resource,
+                                                                               const size_t num_threads)
+  {
+    std::vector<std::optional<workload_map>> maps(num_threads);
+    std::vector<map_workload_result> results(num_threads);
+    std::barrier sync{static_cast<std::ptrdiff_t>(num_threads)};
+
+    {
+      std::vector<std::jthread> threads;
+      threads.reserve(num_threads);
+
+      for (size_t i = 0; i < num_threads; ++i)
+        threads.emplace_back([&, i] {
+          results[i] = perform_deterministic_random_map_ops(maps[i].emplace(resource));
+          sync.arrive_and_wait();
+          maps[(i + 1) % num_threads].reset();
+        });
+    }
+
+    map_workload_result total;
+    for (const auto& result : results)
+    {
+      total.n_inserted += result.n_inserted;
+      total.n_erased += result.n_erased;
+    }
+
+    return total;
+  }
+}  // namespace quxflux
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "tracking_mem_resource.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <memory_resource>
+
+namespace quxflux
+{
+  struct pool_tuning_options
+  {
+    // share of the requests which should be served from the pools, the largest requests beyond it are passed to the
+    // upstream resource directly
+    double pooled_request_share = 0.99;
+    // sizes of which fewer blocks are estimated to be live at the peak usage are passed to the upstream resource
+    // directly: a pool of a handful of large blocks is costlier than allocating them one by one
+    size_t min_pooled_blocks = 4;
+    // no pools are configured for blocks larger than this, however frequent they are
+    size_t max_pooled_block = size_t{1} << 20;
+  };
+
+  // derives the pool_options of a std::pmr::(un)synchronized_pool_resource from the requests a tracking_mem_resource
+  // has seen, typically while running the workload on top of std::pmr::new_delete_resource():
+  // - largest_required_pool_block is the upper bound of the largest size histogram bucket which is needed to cover
+  //   pooled_request_share of the requests and of which at least min_pooled_blocks blocks are live at the peak
+  // - max_blocks_per_chunk is the number of blocks of the most demanded pool at the peak usage, rounded up to a
+  //   power of two. The chunks of a pool double in size up to it, so a pool reaches its peak in a few upstream
+  //   allocations without overshooting it by more than a chunk.
+  // The histogram doesn't record when the blocks were live, so the number of blocks at the peak usage is estimated
+  // assuming that each bucket shares in the peak usage as in the allocated bytes and that every request is as large
+  // as the upper bound of its bucket.
+  inline std::pmr::pool_options tune_pool_options(const tracking_mem_resource::statistics& stats,
+                                                  const pool_tuning_options& tuning = {})
+  {
+    const auto& sizes = stats.size_histogram;
+    const auto bucket_size = [](const size_t bucket) { return size_t{1} << std::min<size_t>(bucket, 63); };
+
+    double all_bytes = 0;
+    for (size_t b = 0; b < sizes.size(); ++b)
+      all_bytes += static_cast<double>(sizes[b]) * static_cast<double>(bucket_size(b));
+
+    const auto peak_blocks = [&](const size_t bucket) {
+      return all_bytes > 0 ? static_cast<double>(stats.peak_bytes_in_use) * static_cast<double>(sizes[bucket]) /
+                               all_bytes
+                           : 0.0;
+    };
+
+    // the last bucket whose upper bound doesn't exceed max_pooled_block
+    const auto largest_bucket = std::max<size_t>(std::bit_width(tuning.max_pooled_block), 1) - 1;
+
+    size_t largest_pooled_bucket = 0;
+    size_t max_blocks = 1;
+    double n_covered = 0;
+
+    for (size_t b = 0; b <= largest_bucket; ++b)
+    {
+      if (n_covered >= tuning.pooled_request_share * static_cast<double>(stats.n_allocations))
+        break;
+
+      n_covered += static_cast<double>(sizes[b]);
+
+      if (sizes[b] > 0 && peak_blocks(b) >= static_cast<double>(tuning.min_pooled_blocks))
+      {
+        largest_pooled_bucket = b;
+        max_blocks = std::max(max_blocks, static_cast<size_t>(std::ceil(peak_blocks(b))));
+      }
+    }
+
+    return {.max_blocks_per_chunk = std::bit_ceil(max_blocks),
+            .largest_required_pool_block = bucket_size(largest_pooled_bucket)};
+  }
+
+  // a pool resource configured by tune_pool_options
+  template<typename Pool = std::pmr::unsynchronized_pool_resource>
+  Pool make_tuned_pool_resource(const tracking_mem_resource::statistics& stats,
+                                std::pmr::memory_resource* upstream = std::pmr::get_default_resource(),
+                                const pool_tuning_options& tuning = {})
+  {
+    return Pool{tune_pool_options(stats, tuning), upstream};
+  }
+}  // namespace quxflux
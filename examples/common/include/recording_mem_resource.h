@@ -0,0 +1,154 @@
+#pragma once
+
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <istream>
+#include <memory_resource>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace quxflux
+{
+  enum class allocation_event_kind
+  {
+    allocate,
+    deallocate
+  };
+
+  struct allocation_event
+  {
+    allocation_event_kind kind = allocation_event_kind::allocate;
+    size_t n_bytes = 0;
+    size_t alignment = 0;
+    // the blocks are numbered in the order of their allocation, a deallocation refers to the number of its block
+    size_t block = 0;
+    // time since the recording started
+    std::chrono::nanoseconds time{};
+  };
+
+  using allocation_trace = std::vector<allocation_event>;
+
+  // forwards all requests to an upstream resource and records them in a trace, which may be replayed on other
+  // resources (see replay_trace). The resource may be used from multiple threads concurrently if the upstream
+  // resource may, the requests of all threads are recorded in a single trace in the order they happened.
+  class recording_mem_resource : public std::pmr::memory_resource
+  {
+  public:
+    explicit recording_mem_resource(std::pmr::memory_resource* upstream_resource = std::pmr::new_delete_resource())
+      : upstream_resource_(upstream_resource)
+    {}
+
+    allocation_trace get_trace() const
+    {
+      std::scoped_lock lock{mutex_};
+      return trace_;
+    }
+
+  private:
+    using clock = std::chrono::steady_clock;
+
+    void* do_allocate(const size_t n_bytes, const size_t alignment) final
+    {
+      void* const ptr = upstream_resource_->allocate(n_bytes, alignment);
+
+      std::scoped_lock lock{mutex_};
+      const auto block = num_blocks_++;
+      live_blocks_.emplace(ptr, block);
+      trace_.push_back({allocation_event_kind::allocate, n_bytes, alignment, block, clock::now() - start_});
+
+      return ptr;
+    }
+
+    void do_deallocate(void* const ptr, const size_t n_bytes, const size_t alignment) final
+    {
+      {
+        // recorded before the block is returned, so that it can't be allocated again before its deallocation has
+        // been recorded
+        std::scoped_lock lock{mutex_};
+        const auto it = live_blocks_.find(ptr);
+        trace_.push_back({allocation_event_kind::deallocate, n_bytes, alignment, it->second, clock::now() - start_});
+        live_blocks_.erase(it);
+      }
+
+      upstream_resource_->deallocate(ptr, n_bytes, alignment);
+    }
+
+    bool do_is_equal(const memory_resource& that) const noexcept final { return this == &that; }
+
+    std::pmr::memory_resource* upstream_resource_;
+    const clock::time_point start_ = clock::now();
+
+    mutable std::mutex mutex_;
+    allocation_trace trace_;
+    std::unordered_map<void*, size_t> live_blocks_;
+    size_t num_blocks_ = 0;
+  };
+
+  // writes the trace as comma separated values, one event per line, e.g. "a,48,8,0,1250" for the allocation of the
+  // first block of 48 bytes aligned to 8 bytes 1250 ns after the start of the recording
+  inline void write_trace(std::ostream& os, const allocation_trace& trace)
+  {
+    os << "kind,bytes,alignment,block,time_ns\n";
+
+    for (const auto& e : trace)
+      os << (e.kind == allocation_event_kind::allocate ? 'a' : 'd') << ',' << e.n_bytes << ',' << e.alignment << ','
+         << e.block << ',' << e.time.count() << '\n';
+  }
+
+  // reads a trace written by write_trace, throws if it is malformed
+  inline allocation_trace read_trace(std::istream& is)
+  {
+    allocation_trace trace;
+    std::string line;
+
+    const auto malformed = [&] { return std::runtime_error("malformed allocation event \"" + line + '"'); };
+
+    // skips the header
+    std::getline(is, line);
+
+    while (std::getline(is, line))
+    {
+      std::string_view fields{line};
+
+      const auto next_number = [&] {
+        if (fields.empty() || fields.front() != ',')
+          throw malformed();
+
+        fields.remove_prefix(1);
+
+        size_t value = 0;
+        const auto [ptr, ec] = std::from_chars(fields.data(), fields.data() + fields.size(), value);
+        if (ec != std::errc{})
+          throw malformed();
+
+        fields.remove_prefix(static_cast<size_t>(ptr - fields.data()));
+        return value;
+      };
+
+      if (line.empty() || (line.front() != 'a' && line.front() != 'd'))
+        throw malformed();
+
+      fields.remove_prefix(1);
+
+      allocation_event e{.kind = line.front() == 'a' ? allocation_event_kind::allocate
+                                                      : allocation_event_kind::deallocate};
+      e.n_bytes = next_number();
+      e.alignment = next_number();
+      e.block = next_number();
+      e.time = std::chrono::nanoseconds{static_cast<std::chrono::nanoseconds::rep>(next_number())};
+
+      if (!fields.empty())
+        throw malformed();
+
+      trace.push_back(e);
+    }
+
+    return trace;
+  }
+}  // namespace quxflux
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+namespace quxflux
+{
+  struct thread_caching_pool_options
+  {
+    // requests larger than this (after rounding up to a power of two) are passed to the upstream resource
+    size_t largest_cached_block = 4096;
+    // number of blocks moved between a thread cache and the shared pool at once. A thread cache keeps at most twice
+    // as many free blocks per size class, the surplus is returned to the shared pool.
+    size_t batch_size = 32;
+    // the first chunk of a size class holds this many blocks, every further one growth_factor times as many as its
+    // predecessor until a chunk reaches max_chunk_bytes
+    size_t initial_blocks_per_chunk = 64;
+    size_t chunk_growth_factor = 2;
+    size_t max_chunk_bytes = size_t{1} << 20;
+  };
+
+  // pool resource which may be used from multiple threads concurrently. Unlike std::pmr::synchronized_pool_resource
+  // every thread allocates from and deallocates to a cache of its own, so most requests don't synchronize at all.
+  // The blocks are pooled in power of two size classes. A thread cache which runs empty takes a batch of blocks
+  // from the shared pool of the size class, one which exceeds twice the batch size returns a batch, so blocks
+  // deallocated by another thread than the one which allocated them flow back through the shared pool. The shared
+  // pools are locked per size class, only refilling them and the requests exceeding the largest cached block reach
+  // the upstream resource, which is serialized.
+  class thread_caching_pool_resource : public std::pmr::memory_resource
+  {
+  public:
+    explicit thread_caching_pool_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+      : thread_caching_pool_resource(thread_caching_pool_options{}, upstream)
+    {}
+
+    explicit thread_caching_pool_resource(const thread_caching_pool_options& options,
+                                          std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+      : upstream_(upstream), options_(sanitized(options)),
+        num_size_classes_(static_cast<size_t>(std::countr_zero(options_.largest_cached_block)) - min_block_shift + 1),
+        shared_pools_(std::make_unique<shared_pool[]>(num_size_classes_))
+    {
+      for (size_t c = 0; c < num_size_classes_; ++c)
+        shared_pools_[c].next_chunk_blocks = options_.initial_blocks_per_chunk;
+    }
+
+    thread_caching_pool_resource(const thread_caching_pool_resource&) = delete;
+    thread_caching_pool_resource& operator=(const thread_caching_pool_resource&) = delete;
+
+    // all chunks are returned to upstream, the caches of the threads which used the resource are abandoned
+    ~thread_caching_pool_resource() override
+    {
+      {
+        std::scoped_lock lock{caches_mutex_};
+        for (const auto& cache : caches_)
+          cache->abandoned.store(true, std::memory_order_relaxed);
+      }
+
+      for (size_t c = 0; c < num_size_classes_; ++c)
+        for (const auto& chunk : shared_pools_[c].chunks)
+          upstream_->deallocate(chunk.ptr, chunk.n_bytes, block_size(c));
+    }
+
+    std::pmr::memory_resource* upstream_resource() const { return upstream_; }
+    const thread_caching_pool_options& options() const { return options_; }
+
+  private:
+    static constexpr size_t min_block_shift = 3;
+    static constexpr size_t min_block_size = size_t{1} << min_block_shift;
+
+    struct free_block
+    {
+      free_block* next;
+    };
+
+    static_assert(sizeof(free_block) <= min_block_size);
+
+    struct free_list
+    {
+      free_block* head = nullptr;
+      size_t size = 0;
+
+      void push(free_block* const block)
+      {
+        block->next = head;
+        head = block;
+        ++size;
+      }
+
+      free_block* pop()
+      {
+        auto* const block = head;
+        head = block->next;
+        --size;
+        return block;
+      }
+
+      // moves up to n blocks to the front of that
+      void move_to(free_list& that, const size_t n)
+      {
+        for (size_t i = 0; i < n && head; ++i)
+          that.push(pop());
+      }
+    };
+
+    struct thread_cache
+    {
+      explicit thread_cache(const size_t num_size_classes) : free_lists(num_size_classes) {}
+
+      std::vector<free_list> free_lists;
+      // false once the thread owning the cache exited, another thread may then adopt it including its free blocks
+      std::atomic<bool> owned{true};
+      // set when the resource is destroyed, the cache is then dropped by the threads which still refer to it
+      std::atomic<bool> abandoned{false};
+    };
+
+    struct upstream_chunk
+    {
+      void* ptr;
+      size_t n_bytes;
+    };
+
+    struct shared_pool
+    {
+      std::mutex mutex;
+      free_list free_blocks;
+      std::vector<upstream_chunk> chunks;
+      size_t next_chunk_blocks = 0;
+    };
+
+    // the caches of the executing thread, one for each resource it used
+    struct thread_registry
+    {
+      struct entry
+      {
+        std::uint64_t resource_id;
+        std::shared_ptr<thread_cache> cache;
+      };
+
+      std::vector<entry> entries;
+
+      ~thread_registry()
+      {
+        for (const auto& e : entries)
+          e.cache->owned.store(false, std::memory_order_release);
+      }
+    };
+
+    static thread_caching_pool_options sanitized(thread_caching_pool_options options)
+    {
+      options.largest_cached_block = std::bit_ceil(std::max(options.largest_cached_block, min_block_size));
+      options.batch_size = std::max<size_t>(options.batch_size, 1);
+      options.initial_blocks_per_chunk = std::max<size_t>(options.initial_blocks_per_chunk, 1);
+      options.chunk_growth_factor = std::max<size_t>(options.chunk_growth_factor, 1);
+      return options;
+    }
+
+    static std::uint64_t next_resource_id()
+    {
+      static std::atomic<std::uint64_t> next_id{0};
+      return next_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static size_t block_size(const size_t size_class) { return min_block_size << size_class; }
+
+    // every block of a size class is aligned to its size, so the alignment is satisfied by rounding up to it
+    size_t size_class(const size_t n_bytes, const size_t alignment) const
+    {
+      const auto size = std::bit_ceil(std::max({n_bytes, alignment, min_block_size}));
+      return size > options_.largest_cached_block ? num_size_classes_
+                                                  : static_cast<size_t>(std::countr_zero(size)) - min_block_shift;
+    }
+
+    thread_cache& local_cache()
+    {
+      thread_local thread_registry registry;
+
+      // a thread typically uses a handful of resources at most, a linear search is the fastest lookup
+      for (const auto& e : registry.entries)
+        if (e.resource_id == id_)
+          return *e.cache;
+
+      std::erase_if(registry.entries,
+                    [](const auto& e) { return e.cache->abandoned.load(std::memory_order_relaxed); });
+
+      return *registry.entries.emplace_back(id_, acquire_cache()).cache;
+    }
+
+    // adopts the cache of a thread which exited or creates a new one
+    std::shared_ptr<thread_cache> acquire_cache()
+    {
+      std::scoped_lock lock{caches_mutex_};
+
+      for (const auto& cache : caches_)
+      {
+        bool owned = false;
+        if (cache->owned.compare_exchange_strong(owned, true, std::memory_order_acquire))
+          return cache;
+      }
+
+      return caches_.emplace_back(std::make_shared<thread_cache>(num_size_classes_));
+    }
+
+    void refill(free_list& local, const size_t size_class)
+    {
+      auto& pool = shared_pools_[size_class];
+      std::scoped_lock lock{pool.mutex};
+
+      if (pool.free_blocks.size < options_.batch_size)
+        grow(pool, size_class);
+
+      pool.free_blocks.move_to(local, options_.batch_size);
+    }
+
+    // carves a new chunk into blocks, the pool has to be locked
+    void grow(shared_pool& pool, const size_t size_class)
+    {
+      const auto size = block_size(size_class);
+      const auto max_chunk_blocks = std::max<size_t>(options_.max_chunk_bytes / size, 1);
+      const auto n_blocks = std::min(pool.next_chunk_blocks, max_chunk_blocks);
+      const upstream_chunk new_chunk{allocate_upstream(n_blocks * size, size), n_blocks * size};
+      pool.chunks.push_back(new_chunk);
+      pool.next_chunk_blocks = std::min(n_blocks * options_.chunk_growth_factor, max_chunk_blocks);
+
+      // in reverse so that the blocks are handed out in address order
+      auto* const bytes = static_cast<std::byte*>(new_chunk.ptr);
+      for (size_t i = n_blocks; i-- > 0;)
+        pool.free_blocks.push(reinterpret_cast<free_block*>(bytes + i * size));
+    }
+
+    void* allocate_upstream(const size_t n_bytes, const size_t alignment)
+    {
+      std::scoped_lock lock{upstream_mutex_};
+      return upstream_->allocate(n_bytes, alignment);
+    }
+
+    void* do_allocate(const size_t n_bytes, const size_t alignment) final
+    {
+      const auto c = size_class(n_bytes, alignment);
+      if (c == num_size_classes_)
+        return allocate_upstream(n_bytes, alignment);
+
+      auto& local = local_cache().free_lists[c];
+      if (!local.head)
+        refill(local, c);
+
+      return local.pop();
+    }
+
+    void do_deallocate(void* const ptr, const size_t n_bytes, const size_t alignment) final
+    {
+      const auto c = size_class(n_bytes, alignment);
+      if (c == num_size_classes_)
+      {
+        std::scoped_lock lock{upstream_mutex_};
+        upstream_->deallocate(ptr, n_bytes, alignment);
+        return;
+      }
+
+      auto& local = local_cache().free_lists[c];
+      local.push(static_cast<free_block*>(ptr));
+
+      if (local.size > 2 * options_.batch_size)
+      {
+        auto& pool = shared_pools_[c];
+        std::scoped_lock lock{pool.mutex};
+        local.move_to(pool.free_blocks, options_.batch_size);
+      }
+    }
+
+    bool do_is_equal(const memory_resource& that) const noexcept final { return this == &that; }
+
+    std::pmr::memory_resource* upstream_;
+    thread_caching_pool_options options_;
+    // identifies the resource in the thread registries, unlike its address it is never reused
+    std::uint64_t id_ = next_resource_id();
+    size_t num_size_classes_;
+    std::unique_ptr<shared_pool[]> shared_pools_;
+    std::mutex upstream_mutex_;
+
+    std::mutex caches_mutex_;
+    std::vector<std::shared_ptr<thread_cache>> caches_;
+  };
+}  // namespace quxflux
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "recording_mem_resource.h"
+#include "tracking_mem_resource.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace quxflux
+{
+  struct replay_statistics
+  {
+    size_t n_allocations = 0;
+    size_t n_deallocations = 0;
+    // time spent replaying the requests of the trace
+    std::chrono::nanoseconds duration{};
+    // requests which reached the upstream resource at the end of the chain
+    size_t n_upstream_allocations = 0;
+    size_t n_upstream_deallocations = 0;
+    // highest number of bytes of the blocks of the trace which were allocated at the same time
+    size_t peak_live_bytes = 0;
+    // highest number of bytes the chain held from upstream at the same time
+    size_t peak_upstream_bytes = 0;
+
+    // share of the memory held from upstream at its peak which wasn't occupied by blocks of the trace, i.e. the
+    // memory lost to padding, partially used chunks and blocks freed but not returned upstream
+    double fragmentation() const
+    {
+      return peak_upstream_bytes > 0
+               ? 1.0 - static_cast<double>(peak_live_bytes) / static_cast<double>(peak_upstream_bytes)
+               : 0.0;
+    }
+  };
+
+  // replays the requests of a recorded trace on resource in the order of the trace on the calling thread, as fast as
+  // possible. upstream has to be the last resource of the chain resource belongs to, its peak is only meaningful if
+  // nothing else has been allocated from it before. Blocks which are still allocated at the end of the trace are
+  // deallocated afterwards, which is neither measured nor counted.
+  inline replay_statistics replay_trace(const allocation_trace& trace, std::pmr::memory_resource& resource,
+                                        const tracking_mem_resource& upstream)
+  {
+    size_t num_blocks = 0;
+    for (const auto& e : trace)
+      num_blocks = std::max(num_blocks, e.block + 1);
+
+    std::vector<void*> blocks(num_blocks, nullptr);
+
+    replay_statistics stats;
+    const auto upstream_before = upstream.get_statistics();
+    size_t live_bytes = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (const auto& e : trace)
+    {
+      auto& block = blocks[e.block];
+
+      if (e.kind == allocation_event_kind::allocate)
+      {
+        if (block)
+          throw std::invalid_argument("block " + std::to_string(e.block) + " is allocated twice");
+
+        block = resource.allocate(e.n_bytes, e.alignment);
+        ++stats.n_allocations;
+        live_bytes += e.n_bytes;
+        stats.peak_live_bytes = std::max(stats.peak_live_bytes, live_bytes);
+      } else
+      {
+        if (!block)
+          throw std::invalid_argument("block " + std::to_string(e.block) + " is deallocated but not allocated");
+
+        resource.deallocate(block, e.n_bytes, e.alignment);
+        block = nullptr;
+        ++stats.n_deallocations;
+        live_bytes -= e.n_bytes;
+      }
+    }
+
+    stats.duration = std::chrono::steady_clock::now() - start;
+
+    const auto upstream_after = upstream.get_statistics();
+    stats.n_upstream_allocations = upstream_after.n_allocations - upstream_before.n_allocations;
+    stats.n_upstream_deallocations = upstream_after.n_deallocations - upstream_before.n_deallocations;
+    stats.peak_upstream_bytes = upstream_after.peak_bytes_in_use;
+
+    // the sizes of the blocks which are still allocated are only known from their allocation events
+    for (const auto& e : trace)
+    {
+      if (e.kind == allocation_event_kind::allocate && blocks[e.block])
+      {
+        resource.deallocate(blocks[e.block], e.n_bytes, e.alignment);
+        blocks[e.block] = nullptr;
+      }
+    }
+
+    return stats;
+  }
+}  // namespace quxflux
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace quxflux
+{
+  // forwards all requests to an upstream resource and records statistics about them. The resource may be used
+  // from multiple threads concurrently if the upstream resource may: the counters are sharded per thread so that
+  // threads don't contend for the same cache lines, get_statistics() aggregates the shards. Only the opt-in exact
+  // peak tracking (see peak_tracking) and the sampling share state between the threads.
+  class tracking_mem_resource : public std::pmr::memory_resource
+  {
+  public:
+    enum class peak_tracking
+    {
+      // every shard keeps the high-water mark of the bytes its threads allocated but didn't deallocate yet, the
+      // peak is their sum. Exact if the requests of a single shard reached the resource, otherwise an upper bound
+      // which overestimates the peak badly if blocks are deallocated by another thread than the allocating one.
+      per_shard,
+      // a counter shared by all threads, exact but contended if several threads allocate concurrently
+      exact
+    };
+
+    // bucket i counts the requests with 2^(i-1) <= value < 2^i, bucket 0 counts the requests of size 0
+    static constexpr size_t num_histogram_buckets = 65;
+    using histogram = std::array<size_t, num_histogram_buckets>;
+
+    static constexpr size_t histogram_bucket(const size_t value) { return std::bit_width(value); }
+
+    struct statistics
+    {
+      size_t n_allocations = 0;
+      size_t n_deallocations = 0;
+      size_t n_bytes_allocated = 0;
+      size_t n_bytes_deallocated = 0;
+      // highest number of bytes allocated but not yet deallocated at any point in time, only an upper bound of it
+      // if peak_is_upper_bound is set, see peak_tracking
+      size_t peak_bytes_in_use = 0;
+      bool peak_is_upper_bound = false;
+      histogram size_histogram{};
+      histogram alignment_histogram{};
+
+      constexpr size_t bytes_in_use() const { return n_bytes_allocated - n_bytes_deallocated; }
+    };
+
+    // every sample_interval-th allocation of a thread invokes stack_id() and attributes the allocation to the
+    // returned id, e.g. a hash of the call stack or an id of the code region. Sampling is disabled if
+    // sample_interval is 0 or stack_id is empty.
+    struct sampling_options
+    {
+      size_t sample_interval = 0;
+      std::function<uint64_t()> stack_id;
+    };
+
+    struct stack_sample
+    {
+      uint64_t stack_id = 0;
+      size_t n_allocations = 0;
+      size_t n_bytes = 0;
+    };
+
+    explicit tracking_mem_resource(std::pmr::memory_resource* upstream_resource = std::pmr::new_delete_resource())
+      : tracking_mem_resource(upstream_resource, sampling_options{})
+    {}
+
+    tracking_mem_resource(std::pmr::memory_resource* upstream_resource, const peak_tracking peak)
+      : tracking_mem_resource(upstream_resource, sampling_options{}, peak)
+    {}
+
+    tracking_mem_resource(std::pmr::memory_resource* upstream_resource, sampling_options sampling,
+                          const peak_tracking peak = peak_tracking::per_shard)
+      : upstream_resource_(upstream_resource), sampling_(std::move(sampling)), peak_tracking_(peak),
+        shards_(std::make_unique<shard[]>(num_shards))
+    {}
+
+    statistics get_statistics() const
+    {
+      statistics stats;
+      size_t num_used_shards = 0;
+
+      for (size_t i = 0; i < num_shards; ++i)
+      {
+        const auto& s = shards_[i];
+
+        if (s.n_allocations.load(std::memory_order_relaxed) > 0 ||
+            s.n_deallocations.load(std::memory_order_relaxed) > 0)
+          ++num_used_shards;
+
+        stats.n_allocations += s.n_allocations.load(std::memory_order_relaxed);
+        stats.n_deallocations += s.n_deallocations.load(std::memory_order_relaxed);
+        stats.n_bytes_allocated += s.n_bytes_allocated.load(std::memory_order_relaxed);
+        stats.n_bytes_deallocated += s.n_bytes_deallocated.load(std::memory_order_relaxed);
+
+        for (size_t b = 0; b < num_histogram_buckets; ++b)
+        {
+          stats.size_histogram[b] += s.size_histogram[b].load(std::memory_order_relaxed);
+          stats.alignment_histogram[b] += s.alignment_histogram[b].load(std::memory_order_relaxed);
+        }
+
+        if (peak_tracking_ == peak_tracking::per_shard)
+          stats.peak_bytes_in_use += static_cast<size_t>(s.peak_bytes_in_use.load(std::memory_order_relaxed));
+      }
+
+      if (peak_tracking_ == peak_tracking::exact)
+        stats.peak_bytes_in_use = static_cast<size_t>(peak_bytes_in_use_.load(std::memory_order_relaxed));
+      else
+        stats.peak_is_upper_bound = num_used_shards > 1;
+
+      return stats;
+    }
+
+    // the sampled allocations per stack id, sorted by the number of bytes in descending order
+    std::vector<stack_sample> get_stack_samples() const
+    {
+      std::vector<stack_sample> samples;
+      {
+        std::scoped_lock lock{samples_mutex_};
+        for (const auto& [id, sample] : samples_)
+          samples.push_back(sample);
+      }
+
+      std::ranges::sort(samples, std::ranges::greater{}, &stack_sample::n_bytes);
+      return samples;
+    }
+
+  private:
+    static constexpr size_t num_shards = 64;
+
+    struct alignas(64) shard
+    {
+      std::atomic<size_t> n_allocations{0};
+      std::atomic<size_t> n_deallocations{0};
+      std::atomic<size_t> n_bytes_allocated{0};
+      std::atomic<size_t> n_bytes_deallocated{0};
+      std::array<std::atomic<size_t>, num_histogram_buckets> size_histogram{};
+      std::array<std::atomic<size_t>, num_histogram_buckets> alignment_histogram{};
+      // high-water mark of n_bytes_allocated - n_bytes_deallocated. The difference is negative while the threads of
+      // the shard deallocated more bytes allocated by other threads than they allocated themselves.
+      std::atomic<std::ptrdiff_t> peak_bytes_in_use{0};
+    };
+
+    static void update_peak(std::atomic<std::ptrdiff_t>& peak, const std::ptrdiff_t in_use)
+    {
+      auto current = peak.load(std::memory_order_relaxed);
+      while (in_use > current && !peak.compare_exchange_weak(current, in_use, std::memory_order_relaxed))
+      {}
+    }
+
+    // threads are assigned to the shards round robin, so the first num_shards threads never share a shard
+    static size_t this_thread_shard()
+    {
+      static std::atomic<size_t> next_shard{0};
+      thread_local const size_t shard_index = next_shard.fetch_add(1, std::memory_order_relaxed) % num_shards;
+      return shard_index;
+    }
+
+    void* do_allocate(size_t n_bytes, size_t alignment) final
+    {
+      void* const ptr = upstream_resource_->allocate(n_bytes, alignment);
+
+      auto& s = shards_[this_thread_shard()];
+      const auto n = s.n_allocations.fetch_add(1, std::memory_order_relaxed);
+      const auto allocated = s.n_bytes_allocated.fetch_add(n_bytes, std::memory_order_relaxed) + n_bytes;
+      s.size_histogram[histogram_bucket(n_bytes)].fetch_add(1, std::memory_order_relaxed);
+      s.alignment_histogram[histogram_bucket(alignment)].fetch_add(1, std::memory_order_relaxed);
+
+      if (peak_tracking_ == peak_tracking::per_shard)
+      {
+        // the difference wraps around if it is negative, converting it back to a signed value undoes that
+        update_peak(s.peak_bytes_in_use,
+                    static_cast<std::ptrdiff_t>(allocated - s.n_bytes_deallocated.load(std::memory_order_relaxed)));
+      } else
+      {
+        // the exact live byte count can't be sharded: a block may be deallocated by another thread than the one
+        // which allocated it
+        update_peak(peak_bytes_in_use_,
+                    bytes_in_use_.fetch_add(static_cast<std::ptrdiff_t>(n_bytes), std::memory_order_relaxed) +
+                      static_cast<std::ptrdiff_t>(n_bytes));
+      }
+
+      if (sampling_.sample_interval > 0 && sampling_.stack_id && n % sampling_.sample_interval == 0)
+        record_sample(n_bytes);
+
+      return ptr;
+    }
+
+    void do_deallocate(void* ptr, size_t n_bytes, size_t alignment) final
+    {
+      auto& s = shards_[this_thread_shard()];
+      s.n_deallocations.fetch_add(1, std::memory_order_relaxed);
+      s.n_bytes_deallocated.fetch_add(n_bytes, std::memory_order_relaxed);
+      if (peak_tracking_ == peak_tracking::exact)
+        bytes_in_use_.fetch_sub(static_cast<std::ptrdiff_t>(n_bytes), std::memory_order_relaxed);
+
+      upstream_resource_->deallocate(ptr, n_bytes, alignment);
+    }
+
+    bool do_is_equal(const memory_resource& that) const noexcept final { return this == &that; }
+
+    void record_sample(const size_t n_bytes)
+    {
+      const auto id = sampling_.stack_id();
+
+      std::scoped_lock lock{samples_mutex_};
+      auto& sample = samples_[id];
+      sample.stack_id = id;
+      ++sample.n_allocations;
+      sample.n_bytes += n_bytes;
+    }
+
+    std::pmr::memory_resource* upstream_resource_;
+    sampling_options sampling_;
+    peak_tracking peak_tracking_;
+    std::unique_ptr<shard[]> shards_;
+    // only used by peak_tracking::exact
+    std::atomic<std::ptrdiff_t> bytes_in_use_{0};
+    std::atomic<std::ptrdiff_t> peak_bytes_in_use_{0};
+
+    mutable std::mutex samples_mutex_;
+    std::unordered_map<uint64_t, stack_sample> samples_;
+  };
+
+  inline std::ostream& operator<<(std::ostream& os, const tracking_mem_resource::statistics& stats)
+  {
+    os.setf(std::ios_base::fixed, std::ios_base::floatfield);
+    os.precision(1);
+
+    os << "allocated " << static_cast<float>(stats.n_bytes_allocated) / 1024 << " KiB in " << stats.n_allocations
+       << " allocation requests.\n";
+    os << "deallocated " << static_cast<float>(stats.n_bytes_deallocated) / 1024 << " KiB in " << stats.n_deallocations
+       << " deallocation requests.\n";
+    os << (stats.peak_is_upper_bound ? "peak usage at most " : "peak usage ")
+       << static_cast<float>(stats.peak_bytes_in_use) / 1024 << " KiB.";
+
+    return os;
+  }
+
+  // prints one line per non-empty bucket, e.g. "[32, 64): 120"
+  inline void write_histogram(std::ostream& os, const tracking_mem_resource::histogram& histogram)
+  {
+    for (size_t i = 0; i < histogram.size(); ++i)
+    {
+      if (histogram[i] == 0)
+        continue;
+
+      if (i == 0)
+        os << "0: " << histogram[i] << '\n';
+      else if (i == histogram.size() - 1)
+        os << "[2^63, 2^64): " << histogram[i] << '\n';
+      else
+        os << '[' << (size_t{1} << (i - 1)) << ", " << (size_t{1} << i) << "): " << histogram[i] << '\n';
+    }
+  }
+}  // namespace quxflux
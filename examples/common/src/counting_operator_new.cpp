@@ -0,0 +1,117 @@
+#include "global_allocation_counter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace
+{
+  std::atomic<size_t> n_allocations{0};
+  std::atomic<size_t> n_bytes_allocated{0};
+
+  void count(const size_t n_bytes)
+  {
+    n_allocations.fetch_add(1, std::memory_order_relaxed);
+    n_bytes_allocated.fetch_add(n_bytes, std::memory_order_relaxed);
+  }
+
+  void* allocate(const size_t n_bytes)
+  {
+    count(n_bytes);
+
+    while (true)
+    {
+      if (void* const ptr = std::malloc(n_bytes == 0 ? 1 : n_bytes))
+        return ptr;
+
+      const auto handler = std::get_new_handler();
+      if (!handler)
+        throw std::bad_alloc{};
+
+      handler();
+    }
+  }
+
+  void* aligned_malloc(const size_t n_bytes, const size_t alignment)
+  {
+#ifdef _WIN32
+    // the CRT doesn't provide aligned_alloc, blocks of _aligned_malloc have to be freed by _aligned_free
+    return _aligned_malloc(std::max<size_t>(n_bytes, 1), alignment);
+#else
+    // aligned_alloc requires the size to be a multiple of the alignment
+    return std::aligned_alloc(alignment, (std::max<size_t>(n_bytes, 1) + alignment - 1) / alignment * alignment);
+#endif
+  }
+
+  void aligned_free(void* const ptr)
+  {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+  }
+
+  void* allocate(const size_t n_bytes, const std::align_val_t alignment)
+  {
+    count(n_bytes);
+
+    while (true)
+    {
+      if (void* const ptr = aligned_malloc(n_bytes, static_cast<size_t>(alignment)))
+        return ptr;
+
+      const auto handler = std::get_new_handler();
+      if (!handler)
+        throw std::bad_alloc{};
+
+      handler();
+    }
+  }
+}  // namespace
+
+namespace quxflux
+{
+  global_allocation_counts get_global_allocation_counts()
+  {
+    return {.n_allocations = n_allocations.load(std::memory_order_relaxed),
+            .n_bytes_allocated = n_bytes_allocated.load(std::memory_order_relaxed)};
+  }
+}  // namespace quxflux
+
+// the standard library implements the array and nothrow versions in terms of these, so replacing them is sufficient
+// to count all allocations
+void* operator new(const size_t n_bytes)
+{
+  return allocate(n_bytes);
+}
+
+void* operator new(const size_t n_bytes, const std::align_val_t alignment)
+{
+  return allocate(n_bytes, alignment);
+}
+
+void operator delete(void* const ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* const ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* const ptr, std::align_val_t) noexcept
+{
+  aligned_free(ptr);
+}
+
+void operator delete(void* const ptr, size_t, std::align_val_t) noexcept
+{
+  aligned_free(ptr);
+}
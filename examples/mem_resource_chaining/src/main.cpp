@@ -1,111 +1,167 @@
+#include "forwarding_mem_resource.h"
+#include "map_workload.h"
+#include "pool_tuning.h"
+#include "recording_mem_resource.h"
+#include "thread_caching_pool_resource.h"
+#include "trace_replay.h"
+#include "tracking_mem_resource.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <cstdlib>
+#include <exception>
+#include <fstream>
 #include <iostream>
 #include <memory_resource>
-#include <random>
-#include <unordered_map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace
 {
-  class tracking_mem_resource : public std::pmr::memory_resource
-  {
-  public:
-    struct statistics
-    {
-      size_t n_allocations = 0;
-      size_t n_deallocations = 0;
-      size_t n_bytes_allocated = 0;
-      size_t n_bytes_deallocated = 0;
-    };
+  namespace qf = quxflux;
 
-    constexpr explicit tracking_mem_resource(
-      std::pmr::memory_resource* upstream_resource = std::pmr::new_delete_resource())
-      : upstream_resource_(upstream_resource)
-    {}
+  void perform_and_report_map_ops(std::pmr::memory_resource* resource)
+  {
+    const auto result = qf::perform_deterministic_random_map_ops(resource);
+    std::cout << "inserted " << result.n_inserted << " items, erased " << result.n_erased << " items\n";
+  }
 
-    constexpr const statistics& get_statistics() const { return statistics_; }
+  // runs the map operations on each of the thread counts concurrently, all threads sharing the resource created by
+  // make_resource(upstream). Without count_upstream the upstream resource is std::pmr::new_delete_resource() and
+  // the upstream allocations aren't reported: counting every request of a resource which forwards all of them
+  // would slow it down.
+  template<typename MakeResource>
+  void report_concurrent_map_ops(const char* const name, const std::vector<size_t>& thread_counts,
+                                 MakeResource make_resource, const bool count_upstream = true)
+  {
+    std::cout << "  " << name << ':';
 
-  private:
-    void* do_allocate(size_t n_bytes, size_t alignment) final
+    for (const auto num_threads : thread_counts)
     {
-      ++statistics_.n_allocations;
-      statistics_.n_bytes_allocated += n_bytes;
-      return upstream_resource_->allocate(n_bytes, alignment);
-    }
+      qf::tracking_mem_resource upstream;
+      std::chrono::milliseconds duration{};
+      {
+        auto resource = make_resource(count_upstream ? &upstream : std::pmr::new_delete_resource());
+        const auto start = std::chrono::steady_clock::now();
+        qf::perform_deterministic_random_map_ops_concurrently(&resource, num_threads);
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+      }
 
-    void do_deallocate(void* ptr, size_t n_bytes, size_t alignment) final
-    {
-      ++statistics_.n_deallocations;
-      statistics_.n_bytes_deallocated += n_bytes;
-      upstream_resource_->deallocate(ptr, n_bytes, alignment);
+      std::cout << ' ' << num_threads << (num_threads == 1 ? " thread " : " threads ") << duration;
+      if (count_upstream)
+        std::cout << " (" << upstream.get_statistics().n_allocations << " upstream allocations)";
+      std::cout << (num_threads == thread_counts.back() ? "" : ",");
     }
 
-    bool do_is_equal(const memory_resource& that) const noexcept final { return this == &that; }
-
-    statistics statistics_{};
-    std::pmr::memory_resource* upstream_resource_;
-  };
+    std::cout << '\n';
+  }
 
-  std::ostream& operator<<(std::ostream& os, const tracking_mem_resource::statistics& stats)
+  void report_replay(const char* const name, const qf::replay_statistics& stats)
   {
-    os.setf(std::ios_base::fixed, std::ios_base::floatfield);
-    os.precision(1);
-
-    os << "allocated " << static_cast<float>(stats.n_bytes_allocated) / 1024 << " KiB in " << stats.n_allocations
-       << " allocation requests.\n";
-    os << "deallocated " << static_cast<float>(stats.n_bytes_deallocated) / 1024 << " KiB in " << stats.n_deallocations
-       << " deallocation requests.";
-
-    return os;
+    std::cout << "  " << name << ": " << std::chrono::duration_cast<std::chrono::microseconds>(stats.duration) << ", "
+              << stats.n_upstream_allocations << " upstream allocations, peak "
+              << static_cast<float>(stats.peak_upstream_bytes) / 1024 << " KiB held from upstream ("
+              << 100 * stats.fragmentation() << "% not occupied by live blocks)\n";
   }
 
-  // this function performs the same insertions and deletions in an unordered_map on each
-  // invocation. A memory resource has to be passed which provided the unordered_map with
-  // memory.
-  void perform_deterministic_random_map_ops(std::pmr::memory_resource* resource)
+  // replays the trace on several chains of resources, each ending in a tracking_mem_resource on top of
+  // std::pmr::new_delete_resource() which records the upstream calls and the footprint of the chain
+  void report_replays(const qf::allocation_trace& trace)
   {
-    std::mt19937 rd{42};
+    {
+      qf::tracking_mem_resource upstream;
+      report_replay("std::pmr::new_delete_resource()", qf::replay_trace(trace, upstream, upstream));
+    }
 
-    std::pmr::unordered_map<size_t, std::pair<size_t, float>> map{resource};
+    {
+      qf::tracking_mem_resource upstream;
+      std::pmr::unsynchronized_pool_resource pool{&upstream};
+      report_replay("std::pmr::unsynchronized_pool_resource", qf::replay_trace(trace, pool, upstream));
+    }
 
-    size_t n_erased = 0;
-    size_t n_inserted = 0;
+    {
+      // the pool_options are derived from the request sizes and the peak usage of the trace
+      qf::tracking_mem_resource trace_statistics;
+      qf::replay_trace(trace, trace_statistics, trace_statistics);
+      qf::tracking_mem_resource upstream;
+      auto pool = qf::make_tuned_pool_resource(trace_statistics.get_statistics(), &upstream);
+      // the options as adjusted by the pool to the limits of the implementation
+      const auto options = pool.options();
+      const auto name = "std::pmr::unsynchronized_pool_resource with tuned pool_options (max_blocks_per_chunk " +
+                        std::to_string(options.max_blocks_per_chunk) + ", largest_required_pool_block " +
+                        std::to_string(options.largest_required_pool_block) + ')';
+      report_replay(name.c_str(), qf::replay_trace(trace, pool, upstream));
+    }
 
-    for (size_t i = 0, n_operations = std::uniform_int_distribution<size_t>{1000, 1000000}(rd); i < n_operations; ++i)
     {
-      // 50% chance to insert a new element
-      const auto delete_item = std::uniform_int_distribution<int>{0, 1}(rd) == 0;
+      qf::tracking_mem_resource upstream;
+      std::pmr::synchronized_pool_resource pool{&upstream};
+      report_replay("std::pmr::synchronized_pool_resource", qf::replay_trace(trace, pool, upstream));
+    }
 
-      if (delete_item && !map.empty())
-      {
-        auto it = map.begin();
-        std::advance(it, std::uniform_int_distribution<size_t>{0, map.size() - 1}(rd));
-        map.erase(it);
-        ++n_erased;
-      } else
-      {
-        const auto key = std::uniform_int_distribution<size_t>{}(rd);
-        const auto value = std::pair{std::uniform_int_distribution<size_t>{}(rd),
-                                     std::uniform_real_distribution<float>{}(rd)};
+    {
+      qf::tracking_mem_resource upstream;
+      std::pmr::monotonic_buffer_resource monotonic{&upstream};
+      report_replay("std::pmr::monotonic_buffer_resource", qf::replay_trace(trace, monotonic, upstream));
+    }
 
-        const bool did_insert = map.insert(std::pair{key, value}).second;
-        n_inserted += did_insert;
-      }
+    {
+      qf::tracking_mem_resource upstream;
+      std::pmr::monotonic_buffer_resource monotonic{&upstream};
+      std::pmr::unsynchronized_pool_resource pool{&monotonic};
+      report_replay("std::pmr::unsynchronized_pool_resource on std::pmr::monotonic_buffer_resource",
+                    qf::replay_trace(trace, pool, upstream));
     }
 
-    std::cout << "inserted " << n_inserted << " items, erased " << n_erased << " items\n";
+    {
+      qf::tracking_mem_resource upstream;
+      qf::thread_caching_pool_resource pool{&upstream};
+      report_replay("thread_caching_pool_resource", qf::replay_trace(trace, pool, upstream));
+    }
   }
 }  // namespace
 
-int main()
+int main(int argc, char** argv)
 {
+  // a trace written by write_trace, e.g. recorded from a production workload, is replayed on the resource chains
+  if (argc > 1)
+  {
+    try
+    {
+      std::ifstream ifs;
+      ifs.exceptions(std::ios_base::badbit);
+      ifs.open(argv[1]);
+      if (!ifs)
+        throw std::runtime_error(std::string{"can't open "} + argv[1]);
+
+      const auto trace = qf::read_trace(ifs);
+      std::cout << "replaying " << trace.size() << " requests of " << argv[1] << '\n';
+      report_replays(trace);
+    }
+    catch (const std::exception& e)
+    {
+      std::cerr << e.what() << "\n\nusage: mem_resource_chaining [allocation trace]\n";
+      return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+  }
+
   {
     // the default upstream resource is std::pmr::new_delete_resource(), so this will behave somewhat
     // similar to as when using a std::unordered_map instead of the std::pmr::unordered_map with
     // custom memory_resource.
     std::cout << "performing allocations with std::pmr::new_delete_resource() upstream resource\n";
-    tracking_mem_resource tracking_mem_resource;
-    perform_deterministic_random_map_ops(&tracking_mem_resource);
-    std::cout << tracking_mem_resource.get_statistics() << "\n\n";
+    qf::tracking_mem_resource tracking_mem_resource;
+    perform_and_report_map_ops(&tracking_mem_resource);
+    std::cout << tracking_mem_resource.get_statistics() << '\n';
+    // the size classes which would benefit from pooling
+    std::cout << "request sizes in bytes:\n";
+    qf::write_histogram(std::cout, tracking_mem_resource.get_statistics().size_histogram);
+    std::cout << '\n';
   }
 
   {
@@ -114,10 +170,10 @@ int main()
     // using this memory resource will drastically reduce the number of allocations requested by the
     // upstream resource because the chunks allocated by the unsynchronized_pool_resource will be reused.
     std::cout << "performing allocations with downstream std::pmr::unsynchronized_pool_resource\n";
-    tracking_mem_resource tracking_mem_resource;
+    qf::tracking_mem_resource tracking_mem_resource;
     {
       std::pmr::unsynchronized_pool_resource pool_res{&tracking_mem_resource};
-      perform_deterministic_random_map_ops(&pool_res);
+      perform_and_report_map_ops(&pool_res);
       std::cout << tracking_mem_resource.get_statistics() << '\n';
     }
     // unsynchronized_pool_resource will only free its remaining acquired memory once it goes out of scope.
@@ -130,15 +186,46 @@ int main()
     // out of scope. The size of the requested buffers hereby follows a geometric progression. Therefore
     // the number of allocations should be less than with the std::pmr::new_delete_resource().
     std::cout << "performing allocations with downstream std::pmr::monotonic_buffer_resource\n";
-    tracking_mem_resource tracking_mem_resource{};
+    qf::tracking_mem_resource tracking_mem_resource{};
     {
       std::pmr::monotonic_buffer_resource monotonic_res{&tracking_mem_resource};
-      perform_deterministic_random_map_ops(&monotonic_res);
+      perform_and_report_map_ops(&monotonic_res);
       std::cout << tracking_mem_resource.get_statistics() << '\n';
     }
     // unsynchronized_pool_resource will only free its memory once it goes out of scope.
     std::cout << "deallocating monotonic_buffer_resource\n";
-    std::cout << tracking_mem_resource.get_statistics() << '\n';
+    std::cout << tracking_mem_resource.get_statistics() << "\n\n";
+  }
+
+  {
+    // several threads sharing a resource: synchronized_pool_resource serializes all threads on its lock (at least
+    // while refilling its pools), thread_caching_pool_resource serves most requests from a cache per thread. Each
+    // thread performs the same map operations, so the duration stays constant if the resource scales perfectly.
+    std::vector<size_t> thread_counts{1, 2, 4, 8, std::max(size_t{1}, size_t{std::thread::hardware_concurrency()})};
+    std::ranges::sort(thread_counts);
+    const auto [last, end] = std::ranges::unique(thread_counts);
+    thread_counts.erase(last, end);
+
+    std::cout << "performing allocations concurrently on several threads\n";
+    report_concurrent_map_ops(
+      "std::pmr::new_delete_resource()", thread_counts,
+      [](std::pmr::memory_resource* upstream) { return qf::forwarding_mem_resource{upstream}; }, false);
+    report_concurrent_map_ops("std::pmr::synchronized_pool_resource", thread_counts,
+                              [](std::pmr::memory_resource* upstream) {
+                                return std::pmr::synchronized_pool_resource{upstream};
+                              });
+    report_concurrent_map_ops("thread_caching_pool_resource", thread_counts, [](std::pmr::memory_resource* upstream) {
+      return qf::thread_caching_pool_resource{upstream};
+    });
+  }
+
+  {
+    // the requests of any run can be recorded and replayed on other chains of resources to find the best one for
+    // the workload without modifying it
+    std::cout << "\nrecording the map operations and replaying them on several chains of resources\n";
+    qf::recording_mem_resource recorder;
+    qf::perform_deterministic_random_map_ops(&recorder);
+    report_replays(recorder.get_trace());
   }
 
   return EXIT_SUCCESS;
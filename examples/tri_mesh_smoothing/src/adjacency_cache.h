@@ -0,0 +1,39 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <typeindex>
+#include <typeinfo>
+
+namespace quxflux::detail
+{
+  // data derived from the adjacency of a mesh, e.g. the tiles of smoothing_kernel::temporally_blocked, which only
+  // has to be computed once as long as the faces don't change. Holds a single entry of any type, concurrent access is
+  // safe.
+  class adjacency_cache
+  {
+  public:
+    // returns the entry if it has type T and matches(entry) is true, otherwise replaces it by the result of make().
+    // make is invoked while holding the lock, so concurrent callers wait for the entry instead of computing it again.
+    template<typename T, typename Matches, typename Make>
+    std::shared_ptr<const T> get_or_make(Matches matches, Make make)
+    {
+      std::scoped_lock lock{mutex_};
+
+      if (type_ == typeid(T))
+        if (auto entry = std::static_pointer_cast<const T>(entry_); matches(*entry))
+          return entry;
+
+      auto entry = std::make_shared<const T>(make());
+      entry_ = entry;
+      type_ = typeid(T);
+
+      return entry;
+    }
+
+  private:
+    std::mutex mutex_;
+    std::shared_ptr<const void> entry_;
+    std::type_index type_ = typeid(void);
+  };
+}  // namespace quxflux::detail
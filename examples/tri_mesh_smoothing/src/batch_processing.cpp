@@ -0,0 +1,273 @@
+#include "batch_processing.h"
+
+#include "laplacian_smoothing.h"
+#include "tracking_mem_resource.h"
+#include "tri_mesh.h"
+
+#include <algorithm>
+#include <exception>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+namespace quxflux
+{
+  namespace
+  {
+    using clock = std::chrono::steady_clock;
+
+    bool is_binary_mesh_file(const std::filesystem::path& path) { return path.extension() == ".bin"; }
+
+    // monotonic arena whose buffer is reused for one mesh after the other. Memory exceeding the buffer is allocated
+    // from the heap, afterwards the buffer is enlarged by the exceeding amount. So the arena stops allocating once it
+    // has seen the largest mesh.
+    class recycled_arena
+    {
+    public:
+      // releases all memory allocated from the arena since the previous call, none of it may be in use anymore
+      std::pmr::memory_resource* reset()
+      {
+        if (arena_)
+        {
+          arena_.reset();
+
+          if (const auto exceeding = heap_.get_statistics().n_bytes_allocated - heap_bytes_; exceeding > 0)
+          {
+            buffer_size_ += exceeding;
+            buffer_ = std::make_unique_for_overwrite<std::byte[]>(buffer_size_);
+            ++num_buffer_allocations_;
+          }
+        }
+
+        heap_bytes_ = heap_.get_statistics().n_bytes_allocated;
+        return &arena_.emplace(buffer_.get(), buffer_size_, &heap_);
+      }
+
+      size_t num_heap_allocations() const { return heap_.get_statistics().n_allocations + num_buffer_allocations_; }
+
+    private:
+      tracking_mem_resource heap_;
+      std::unique_ptr<std::byte[]> buffer_;
+      size_t buffer_size_ = 0;
+      size_t num_buffer_allocations_ = 0;
+      // bytes allocated from the heap before the current mesh
+      size_t heap_bytes_ = 0;
+      std::optional<std::pmr::monotonic_buffer_resource> arena_;
+    };
+
+    // a mesh on its way through the pipeline together with the arena its storage is allocated from
+    struct mesh_slot
+    {
+      size_t input_index = 0;
+      recycled_arena arena;
+      std::unique_ptr<tri_mesh> mesh;
+    };
+
+    using slot_queue = detail::bounded_queue<mesh_slot*>;
+
+    // the path each input is written to, throws if two inputs would be written to the same path or an output would
+    // overwrite one of the inputs. The paths are compared after resolving symbolic links and relative components.
+    std::vector<std::filesystem::path> make_output_paths(const std::span<const std::filesystem::path> inputs,
+                                                         const std::filesystem::path& output_directory)
+    {
+      std::vector<std::filesystem::path> output_paths;
+      output_paths.reserve(inputs.size());
+
+      // resolved output path -> index of the input
+      std::map<std::filesystem::path, size_t> outputs;
+
+      for (size_t i = 0; i < inputs.size(); ++i)
+      {
+        const auto& output_path = output_paths.emplace_back(output_directory / inputs[i].filename());
+
+        if (const auto [it, inserted] = outputs.emplace(std::filesystem::weakly_canonical(output_path), i); !inserted)
+          throw std::invalid_argument("the inputs " + inputs[it->second].string() + " and " + inputs[i].string() +
+                                      " would both be written to " + output_path.string());
+      }
+
+      for (const auto& input : inputs)
+        if (const auto it = outputs.find(std::filesystem::weakly_canonical(input)); it != outputs.end())
+          throw std::invalid_argument("the output of " + inputs[it->second].string() + " would overwrite the input " +
+                                      input.string());
+
+      return output_paths;
+    }
+  }  // namespace
+
+  std::vector<std::filesystem::path> collect_mesh_files(const std::span<const std::filesystem::path> paths)
+  {
+    std::vector<std::filesystem::path> files;
+
+    for (const auto& path : paths)
+    {
+      if (!std::filesystem::exists(path))
+        throw std::filesystem::filesystem_error("mesh file or directory not found", path,
+                                                std::make_error_code(std::errc::no_such_file_or_directory));
+
+      if (!std::filesystem::is_directory(path))
+      {
+        files.push_back(path);
+        continue;
+      }
+
+      const auto first = files.size();
+
+      for (const auto& entry : std::filesystem::directory_iterator{path})
+      {
+        const auto extension = entry.path().extension();
+        if (entry.is_regular_file() && (extension == ".obj" || extension == ".bin"))
+          files.push_back(entry.path());
+      }
+
+      std::sort(files.begin() + static_cast<std::ptrdiff_t>(first), files.end());
+    }
+
+    return files;
+  }
+
+  batch_statistics smooth_mesh_files(const std::span<const std::filesystem::path> inputs, const batch_options& options)
+  {
+    if (options.output_directory.empty())
+      throw std::invalid_argument("the output directory must not be empty");
+
+    std::filesystem::create_directories(options.output_directory);
+    const auto output_paths = make_output_paths(inputs, options.output_directory);
+
+    const auto start = clock::now();
+    batch_statistics stats;
+    std::mutex failures_mutex;
+
+    // a slot for every mesh which may be in flight: one in each queue position and one being processed per stage
+    std::vector<mesh_slot> slots(2 * std::max<size_t>(options.queue_capacity, 1) + 3);
+    slot_queue free_slots{slots.size()};
+    for (auto& slot : slots)
+      free_slots.push(&slot);
+
+    slot_queue loaded{options.queue_capacity};
+    slot_queue smoothed{options.queue_capacity};
+
+    // processes the mesh of the slot and passes it on to output, if processing fails the failure is recorded and
+    // the slot is recycled
+    const auto process = [&](mesh_slot& slot, batch_stage_statistics& stage, slot_queue& output,
+                             const auto& process_mesh) {
+      const auto process_start = clock::now();
+      bool processed = true;
+
+      try
+      {
+        process_mesh(slot);
+      }
+      catch (const std::exception& e)
+      {
+        processed = false;
+        slot.mesh.reset();
+
+        std::scoped_lock lock{failures_mutex};
+        stats.failures.push_back({inputs[slot.input_index], e.what()});
+      }
+
+      const auto process_end = clock::now();
+      stage.busy += process_end - process_start;
+
+      (processed ? output : free_slots).push(&slot);
+      stage.waiting_for_output += clock::now() - process_end;
+    };
+
+    // processes the meshes popped from input until it is closed
+    const auto run_stage = [&](slot_queue& input, batch_stage_statistics& stage, slot_queue& output,
+                               const auto& process_mesh) {
+      while (true)
+      {
+        const auto wait_start = clock::now();
+        const auto slot = input.pop();
+        stage.waiting_for_input += clock::now() - wait_start;
+
+        if (!slot)
+          return;
+
+        process(**slot, stage, output, process_mesh);
+      }
+    };
+
+    const auto load = [&](mesh_slot& slot) {
+      const auto& path = inputs[slot.input_index];
+      const auto resource = slot.arena.reset();
+
+      // the inputs may come from anywhere, so the indices of binary meshes are checked before they are used
+      slot.mesh = is_binary_mesh_file(path) ? read_binary(path, binary_mesh_validation::indices)->clone(resource)
+                                            : read_from_file(path, 1, resource);
+
+      ++stats.load.num_meshes;
+      stats.load.num_vertices += slot.mesh->get_num_vertices();
+      stats.load.num_bytes += std::filesystem::file_size(path);
+    };
+
+    recycled_arena smoothing_arena;
+    const auto smooth = [&](mesh_slot& slot) {
+      // the workers allocate concurrently, the arena isn't thread-safe
+      std::pmr::synchronized_pool_resource pool{smoothing_arena.reset()};
+      laplacian_smoothing(*slot.mesh, options.iterations, allocation_strategy::use_mesh_view,
+                          {.num_threads = options.num_smoothing_threads, .upstream_resource = &pool});
+
+      ++stats.smooth.num_meshes;
+      stats.smooth.num_vertices += slot.mesh->get_num_vertices();
+    };
+
+    recycled_arena writer_arena;
+    const auto write = [&](mesh_slot& slot) {
+      const auto& output_path = output_paths[slot.input_index];
+
+      if (is_binary_mesh_file(output_path))
+        write_binary(*slot.mesh, output_path);
+      else
+        write_to_file(*slot.mesh, output_path, 1, writer_arena.reset());
+
+      ++stats.write.num_meshes;
+      stats.write.num_vertices += slot.mesh->get_num_vertices();
+      stats.write.num_bytes += std::filesystem::file_size(output_path);
+      slot.mesh.reset();
+    };
+
+    {
+      std::jthread loader{[&] {
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+          const auto wait_start = clock::now();
+          auto* const slot = *free_slots.pop();
+          stats.load.waiting_for_input += clock::now() - wait_start;
+
+          slot->input_index = i;
+          process(*slot, stats.load, loaded, load);
+        }
+
+        loaded.close();
+      }};
+
+      std::jthread smoother{[&] {
+        run_stage(loaded, stats.smooth, smoothed, smooth);
+        smoothed.close();
+      }};
+
+      // written meshes are recycled
+      run_stage(smoothed, stats.write, free_slots, write);
+    }
+
+    for (const auto& slot : slots)
+      stats.load.num_heap_allocations += slot.arena.num_heap_allocations();
+    stats.smooth.num_heap_allocations = smoothing_arena.num_heap_allocations();
+    stats.write.num_heap_allocations = writer_arena.num_heap_allocations();
+
+    stats.loaded_queue = loaded.statistics();
+    stats.smoothed_queue = smoothed.statistics();
+    stats.duration = clock::now() - start;
+
+    return stats;
+  }
+}  // namespace quxflux
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "bounded_queue.h"
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace quxflux
+{
+  struct batch_options
+  {
+    // the smoothed meshes are written to this directory under the file names of the inputs, in the same format
+    std::filesystem::path output_directory;
+    size_t iterations = 10;
+    // number of threads smoothing a mesh, 0 selects std::thread::hardware_concurrency()
+    size_t num_smoothing_threads = 1;
+    // maximum number of meshes waiting between two stages. Every mesh in flight holds its own memory, the meshes
+    // in the queues and the ones being processed by the stages.
+    size_t queue_capacity = 2;
+  };
+
+  struct batch_stage_statistics
+  {
+    // meshes processed successfully by the stage
+    size_t num_meshes = 0;
+    size_t num_vertices = 0;
+    // size of the files read respectively written, 0 for the smoothing stage
+    size_t num_bytes = 0;
+    // time spent processing meshes, waiting for a mesh from the previous stage and waiting until the next stage
+    // accepts the processed mesh
+    std::chrono::nanoseconds busy{};
+    std::chrono::nanoseconds waiting_for_input{};
+    std::chrono::nanoseconds waiting_for_output{};
+    // allocations of the memory the stage reuses across meshes from the heap, which stop once the stage has seen the
+    // largest mesh
+    size_t num_heap_allocations = 0;
+  };
+
+  struct batch_failure
+  {
+    std::filesystem::path path;
+    std::string what;
+  };
+
+  struct batch_statistics
+  {
+    batch_stage_statistics load;
+    batch_stage_statistics smooth;
+    batch_stage_statistics write;
+    // the queues between loading and smoothing respectively smoothing and writing
+    detail::queue_statistics loaded_queue;
+    detail::queue_statistics smoothed_queue;
+    // meshes which couldn't be read, smoothed or written, the other meshes are processed nevertheless
+    std::vector<batch_failure> failures;
+    std::chrono::nanoseconds duration{};
+  };
+
+  // replaces the directories among paths by the wavefront obj (.obj) and binary (.bin) mesh files they contain (not
+  // recursively) in lexicographical order, files are taken as they are. Throws if a path doesn't exist.
+  std::vector<std::filesystem::path> collect_mesh_files(std::span<const std::filesystem::path> paths);
+
+  // smoothes the meshes in inputs (see collect_mesh_files) using allocation_strategy::use_mesh_view and writes them
+  // to the output directory, which is created if necessary. Loading, smoothing and writing run concurrently as the
+  // stages of a pipeline which are connected by bounded queues, so reading and writing the files overlaps with
+  // smoothing. Each stage keeps its memory across the meshes: the meshes are allocated from arenas which are
+  // recycled once a mesh has been written, the smoothing and the writer allocate their buffers from arenas of their
+  // own. Throws std::invalid_argument before processing any mesh if two inputs have the same file name or one of
+  // them would be overwritten by an output, e.g. because it is located in the output directory.
+  batch_statistics smooth_mesh_files(std::span<const std::filesystem::path> inputs, const batch_options& options);
+}  // namespace quxflux
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "tri_mesh.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <type_traits>
+
+namespace quxflux::detail
+{
+  // layout of the binary mesh format: the header is followed by the vertex, face, adjacency offset and adjacency
+  // neighbor blocks, each one starting at a multiple of binary_mesh_block_alignment so that the blocks can be used
+  // in place when the file is memory mapped. All values are stored in native byte order.
+  struct binary_mesh_header
+  {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t byte_order_mark;
+    std::uint32_t reserved;
+    // sizeof(vertex_index) respectively sizeof(size_t) of the writer, the file can only be mapped if they match
+    // the ones of the reader
+    std::uint16_t index_size;
+    std::uint16_t offset_size;
+    std::uint64_t num_vertices;
+    std::uint64_t num_faces;
+    std::uint64_t num_neighbors;
+    std::uint64_t vertices_offset;
+    std::uint64_t faces_offset;
+    std::uint64_t adjacency_offsets_offset;
+    std::uint64_t adjacency_neighbors_offset;
+  };
+
+  static_assert(std::is_trivially_copyable_v<binary_mesh_header>);
+
+  inline constexpr std::array<char, 8> binary_mesh_magic{'Q', 'X', 'F', 'X', 'M', 'E', 'S', 'H'};
+  inline constexpr std::uint32_t binary_mesh_version = 1;
+  inline constexpr std::uint32_t binary_mesh_byte_order_mark = 0x01020304;
+  inline constexpr std::uint64_t binary_mesh_block_alignment = 64;
+
+  binary_mesh_header make_binary_mesh_header(std::uint64_t num_vertices, std::uint64_t num_faces,
+                                             std::uint64_t num_neighbors);
+  std::uint64_t binary_mesh_file_size(const binary_mesh_header& header);
+
+  // returns the header of the binary mesh file with the given contents, throws if the file is truncated or doesn't
+  // match the platform and index widths. With binary_mesh_validation::indices it also throws if the adjacency
+  // offsets or any of the indices are out of range.
+  binary_mesh_header read_binary_mesh_header(std::span<const std::byte> data, const std::filesystem::path& path,
+                                             binary_mesh_validation validation);
+
+  // Byte is std::byte or const std::byte, T has to be const in the latter case
+  template<typename T, typename Byte>
+  std::span<T> binary_mesh_block(const std::span<Byte> data, const std::uint64_t offset, const std::uint64_t count)
+  {
+    return {reinterpret_cast<T*>(data.data() + offset), static_cast<size_t>(count)};
+  }
+}  // namespace quxflux::detail
@@ -0,0 +1,319 @@
+#include "tri_mesh.h"
+
+#include "binary_mesh_format.h"
+#include "mapped_file.h"
+#include "tri_mesh_impl.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace quxflux
+{
+  namespace
+  {
+    using detail::binary_mesh_block;
+    using detail::binary_mesh_block_alignment;
+    using detail::binary_mesh_byte_order_mark;
+    using detail::binary_mesh_file_size;
+    using detail::binary_mesh_header;
+    using detail::binary_mesh_magic;
+    using detail::binary_mesh_version;
+    using detail::make_binary_mesh_header;
+    using detail::read_binary_mesh_header;
+
+    constexpr std::uint64_t align_up(const std::uint64_t offset)
+    {
+      return (offset + binary_mesh_block_alignment - 1) / binary_mesh_block_alignment * binary_mesh_block_alignment;
+    }
+
+    [[noreturn]] void fail(const std::filesystem::path& path, const std::string& what)
+    {
+      throw std::runtime_error("can't read binary mesh " + path.string() + ": " + what);
+    }
+
+    void validate(const binary_mesh_header& header, const std::uint64_t size, const std::filesystem::path& path)
+    {
+      const auto fail = [&](const std::string& what) { quxflux::fail(path, what); };
+
+      if (header.magic != binary_mesh_magic)
+        fail("not a binary mesh file");
+
+      if (header.byte_order_mark != binary_mesh_byte_order_mark)
+        fail("the file was written using a different byte order");
+
+      if (header.version != binary_mesh_version)
+        fail("unsupported version " + std::to_string(header.version));
+
+      if (header.index_size != sizeof(vertex_index) || header.offset_size != sizeof(size_t))
+        fail("the file was written using different index widths");
+
+      if (header.num_vertices > std::numeric_limits<vertex_index>::max() ||
+          header.num_faces > std::numeric_limits<face_index>::max())
+        fail("the mesh exceeds the range of the index type");
+
+      // counts which can't fit into the file would overflow the computation of the layout
+      if (header.num_vertices >= size / sizeof(vec3f) || header.num_faces > size / sizeof(face) ||
+          header.num_neighbors > size / sizeof(vertex_index))
+        fail("inconsistent block layout");
+
+      const auto expected = make_binary_mesh_header(header.num_vertices, header.num_faces, header.num_neighbors);
+
+      if (header.vertices_offset != expected.vertices_offset || header.faces_offset != expected.faces_offset ||
+          header.adjacency_offsets_offset != expected.adjacency_offsets_offset ||
+          header.adjacency_neighbors_offset != expected.adjacency_neighbors_offset ||
+          binary_mesh_file_size(header) > size)
+        fail("inconsistent block layout");
+    }
+
+    // the blocks are used in place without any bounds checks, binary_mesh_validation::indices checks the adjacency
+    // offsets and all indices in a single pass over the file
+    void validate_blocks(const binary_mesh_header& header, const std::span<const std::byte> data,
+                         const std::filesystem::path& path)
+    {
+      const auto faces = binary_mesh_block<const vertex_index>(data, header.faces_offset, 3 * header.num_faces);
+      if (std::ranges::any_of(faces, [&](const vertex_index vi) { return vi >= header.num_vertices; }))
+        fail(path, "face index out of range");
+
+      const auto offsets =
+        binary_mesh_block<const size_t>(data, header.adjacency_offsets_offset, header.num_vertices + 1);
+      if (offsets.front() != 0 || offsets.back() != header.num_neighbors ||
+          std::ranges::adjacent_find(offsets, std::ranges::greater{}) != offsets.end())
+        fail(path, "inconsistent adjacency offsets");
+
+      const auto neighbors =
+        binary_mesh_block<const vertex_index>(data, header.adjacency_neighbors_offset, header.num_neighbors);
+      if (std::ranges::any_of(neighbors, [&](const vertex_index vi) { return vi >= header.num_vertices; }))
+        fail(path, "neighbor index out of range");
+    }
+
+    // tri_mesh which uses the blocks of a memory mapped binary mesh file in place. The mapping is copy-on-write,
+    // so pages are shared with the page cache (and thereby other processes mapping the same file) until they are
+    // modified. Changing a face switches to an adjacency which is rebuilt from the faces.
+    class mapped_tri_mesh : public tri_mesh
+    {
+    public:
+      mapped_tri_mesh(const std::filesystem::path& path, const binary_mesh_validation validation)
+        : file_(path, detail::mapped_file::access::copy_on_write)
+      {
+        const auto data = file_.writable_data();
+        const auto header = read_binary_mesh_header(data, path, validation);
+
+        vertices_ = binary_mesh_block<vec3f>(data, header.vertices_offset, header.num_vertices);
+        faces_ = binary_mesh_block<face>(data, header.faces_offset, header.num_faces);
+        mapped_adjacency_ = adjacency_view{
+          binary_mesh_block<const size_t>(data, header.adjacency_offsets_offset, header.num_vertices + 1),
+          binary_mesh_block<const vertex_index>(data, header.adjacency_neighbors_offset, header.num_neighbors)};
+      }
+
+      size_t get_num_vertices() const final { return vertices_.size(); }
+
+      void get_vertex(const vertex_index i, float* const data) const final { std::ranges::copy(vertices_[i], data); }
+
+      void set_vertex(const vertex_index i, const float* const data) final
+      {
+        std::ranges::copy_n(data, 3, vertices_[i].begin());
+      }
+
+      size_t get_vertex_valence(const vertex_index i) const final { return get_adjacency()[i].size(); }
+
+      size_t get_vertex_neighbors(const vertex_index i, vertex_index* const buf, const size_t buf_size) const final
+      {
+        const auto neighbors = get_adjacency()[i];
+        const auto n = std::min(buf_size, neighbors.size());
+        std::copy_n(neighbors.begin(), n, buf);
+
+        return n;
+      }
+
+      size_t get_num_faces() const final { return faces_.size(); }
+
+      void get_face(const face_index i, vertex_index* const data) const final { std::ranges::copy(faces_[i], data); }
+
+      void set_face(const face_index i, const vertex_index* const data) final
+      {
+        std::ranges::copy_n(data, 3, faces_[i].begin());
+        mapped_adjacency_.reset();
+        adjacency_.invalidate();
+      }
+
+      void get_vertices(const vertex_index first, const std::span<vec3f> out) const final
+      {
+        std::ranges::copy(vertices_.subspan(first, out.size()), out.begin());
+      }
+
+      void set_vertices(const vertex_index first, const std::span<const vec3f> data) final
+      {
+        std::ranges::copy(data, vertices_.begin() + static_cast<std::ptrdiff_t>(first));
+      }
+
+      void get_faces(const face_index first, const std::span<face> out) const final
+      {
+        std::ranges::copy(faces_.subspan(first, out.size()), out.begin());
+      }
+
+      std::optional<std::span<const vec3f>> vertices() const final { return vertices_; }
+      std::optional<std::span<const face>> faces() const final { return faces_; }
+      std::optional<adjacency_view> adjacency() const final { return get_adjacency(); }
+      detail::adjacency_cache* adjacency_cache() const final { return &adjacency_.cache(); }
+
+    protected:
+      std::unique_ptr<tri_mesh> do_clone(std::pmr::memory_resource* const resource) const final
+      {
+        return std::make_unique<detail::tri_mesh_impl>(
+          std::pmr::vector<vec3f>(vertices_.begin(), vertices_.end(), resource),
+          std::pmr::vector<face>(faces_.begin(), faces_.end(), resource), get_adjacency(), resource);
+      }
+
+    private:
+      adjacency_view get_adjacency() const
+      {
+        return mapped_adjacency_ ? *mapped_adjacency_ : adjacency_.get(vertices_.size(), faces_);
+      }
+
+      detail::mapped_file file_;
+      std::span<vec3f> vertices_;
+      std::span<face> faces_;
+      std::optional<adjacency_view> mapped_adjacency_;
+      detail::lazy_adjacency adjacency_;
+    };
+
+    template<typename T>
+    void write_block(std::ofstream& ofs, const std::uint64_t offset, const std::span<const T> elements)
+    {
+      ofs.seekp(static_cast<std::streamoff>(offset));
+      ofs.write(reinterpret_cast<const char*>(elements.data()), static_cast<std::streamsize>(elements.size_bytes()));
+    }
+
+    // copies the adjacency of meshes which don't provide a view onto theirs
+    void write_adjacency_using_interface(std::ofstream& ofs, const tri_mesh& mesh, const binary_mesh_header& header)
+    {
+      std::vector<size_t> offsets(mesh.get_num_vertices() + 1, 0);
+      for (vertex_index vi = 0; vi < mesh.get_num_vertices(); ++vi)
+        offsets[vi + 1] = offsets[vi] + mesh.get_vertex_valence(vi);
+
+      write_block<size_t>(ofs, header.adjacency_offsets_offset, offsets);
+
+      std::vector<vertex_index> neighbors;
+      ofs.seekp(static_cast<std::streamoff>(header.adjacency_neighbors_offset));
+
+      for (vertex_index vi = 0; vi < mesh.get_num_vertices(); ++vi)
+      {
+        neighbors.resize(offsets[vi + 1] - offsets[vi]);
+        mesh.get_vertex_neighbors(vi, neighbors.data(), neighbors.size());
+        ofs.write(reinterpret_cast<const char*>(neighbors.data()),
+                  static_cast<std::streamsize>(std::span{neighbors}.size_bytes()));
+      }
+    }
+  }  // namespace
+
+  namespace detail
+  {
+    binary_mesh_header make_binary_mesh_header(const std::uint64_t num_vertices, const std::uint64_t num_faces,
+                                               const std::uint64_t num_neighbors)
+    {
+      binary_mesh_header header{};
+      header.magic = binary_mesh_magic;
+      header.version = binary_mesh_version;
+      header.byte_order_mark = binary_mesh_byte_order_mark;
+      header.index_size = sizeof(vertex_index);
+      header.offset_size = sizeof(size_t);
+      header.num_vertices = num_vertices;
+      header.num_faces = num_faces;
+      header.num_neighbors = num_neighbors;
+
+      header.vertices_offset = align_up(sizeof(binary_mesh_header));
+      header.faces_offset = align_up(header.vertices_offset + num_vertices * sizeof(vec3f));
+      header.adjacency_offsets_offset = align_up(header.faces_offset + num_faces * sizeof(face));
+      header.adjacency_neighbors_offset =
+        align_up(header.adjacency_offsets_offset + (num_vertices + 1) * sizeof(size_t));
+
+      return header;
+    }
+
+    std::uint64_t binary_mesh_file_size(const binary_mesh_header& header)
+    {
+      return header.adjacency_neighbors_offset + header.num_neighbors * sizeof(vertex_index);
+    }
+
+    binary_mesh_header read_binary_mesh_header(const std::span<const std::byte> data, const std::filesystem::path& path,
+                                               const binary_mesh_validation validation)
+    {
+      if (data.size() < sizeof(binary_mesh_header))
+        throw std::runtime_error("can't read binary mesh " + path.string() + ": file is truncated");
+
+      binary_mesh_header header;
+      std::memcpy(&header, data.data(), sizeof(binary_mesh_header));
+      validate(header, data.size(), path);
+      if (validation == binary_mesh_validation::indices)
+        validate_blocks(header, data, path);
+
+      return header;
+    }
+  }  // namespace detail
+
+  void write_binary(const tri_mesh& mesh, const std::filesystem::path& path)
+  {
+    const auto adjacency = mesh.adjacency();
+
+    size_t num_neighbors = 0;
+    if (adjacency)
+      num_neighbors = adjacency->neighbors.size();
+    else
+      for (vertex_index vi = 0; vi < mesh.get_num_vertices(); ++vi)
+        num_neighbors += mesh.get_vertex_valence(vi);
+
+    const auto header = make_binary_mesh_header(mesh.get_num_vertices(), mesh.get_num_faces(), num_neighbors);
+
+    std::ofstream ofs;
+    ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+    ofs.open(path, std::ios_base::binary);
+
+    // the padding between the blocks is zero filled by reserving the whole file up front
+    ofs.seekp(static_cast<std::streamoff>(binary_mesh_file_size(header) - 1));
+    ofs.put('\0');
+
+    write_block(ofs, 0, std::span{&header, 1});
+
+    if (const auto vertices = mesh.vertices())
+    {
+      write_block(ofs, header.vertices_offset, *vertices);
+    } else
+    {
+      std::vector<vec3f> buffer(mesh.get_num_vertices());
+      mesh.get_vertices(0, buffer);
+      write_block<vec3f>(ofs, header.vertices_offset, buffer);
+    }
+
+    if (const auto faces = mesh.faces())
+    {
+      write_block(ofs, header.faces_offset, *faces);
+    } else
+    {
+      std::vector<face> buffer(mesh.get_num_faces());
+      mesh.get_faces(0, buffer);
+      write_block<face>(ofs, header.faces_offset, buffer);
+    }
+
+    if (adjacency)
+    {
+      write_block(ofs, header.adjacency_offsets_offset, adjacency->offsets);
+      write_block(ofs, header.adjacency_neighbors_offset, adjacency->neighbors);
+    } else
+    {
+      write_adjacency_using_interface(ofs, mesh, header);
+    }
+  }
+
+  std::unique_ptr<tri_mesh> read_binary(const std::filesystem::path& path, const binary_mesh_validation validation)
+  {
+    return std::make_unique<mapped_tri_mesh>(path, validation);
+  }
+}  // namespace quxflux
@@ -0,0 +1,243 @@
+#include "blocked_smoothing.h"
+
+#include "parallel.h"
+#include "vertex_averaging.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <ranges>
+#include <utility>
+
+namespace quxflux::detail
+{
+  namespace
+  {
+    constexpr std::uint32_t not_in_tile = std::numeric_limits<std::uint32_t>::max();
+
+    // grows the patches by breadth first search from the lowest unassigned vertex until they reach tile_size
+    // vertices or run out of unassigned neighbors. The vertices of each patch are in the order they were reached.
+    std::vector<std::pmr::vector<vertex_index>> make_patches(const adjacency_view& adjacency,
+                                                             const size_t num_vertices, const size_t tile_size)
+    {
+      std::vector<std::pmr::vector<vertex_index>> patches;
+      std::vector<std::uint8_t> assigned(num_vertices, 0);
+
+      for (size_t seed = 0; seed < num_vertices; ++seed)
+      {
+        if (assigned[seed])
+          continue;
+
+        auto& patch = patches.emplace_back();
+        patch.reserve(std::min(tile_size, num_vertices - seed));
+        patch.push_back(narrow_index<vertex_index>(seed));
+        assigned[seed] = 1;
+
+        for (size_t head = 0; head < patch.size() && patch.size() < tile_size; ++head)
+        {
+          for (const auto neighbor : adjacency[patch[head]])
+          {
+            if (assigned[neighbor])
+              continue;
+
+            assigned[neighbor] = 1;
+            patch.push_back(neighbor);
+
+            if (patch.size() == tile_size)
+              break;
+          }
+        }
+      }
+
+      return patches;
+    }
+
+    // local_index maps global to local indices, all of its entries are not_in_tile before and after the call
+    smoothing_tile make_tile(const adjacency_view& adjacency, std::pmr::vector<vertex_index> patch, const size_t depth,
+                             std::vector<std::uint32_t>& local_index)
+    {
+      smoothing_tile tile;
+      tile.vertices = std::move(patch);
+
+      for (size_t j = 0; j < tile.vertices.size(); ++j)
+        local_index[tile.vertices[j]] = checked_index<std::uint32_t>(j);
+      tile.ring_ends.push_back(tile.vertices.size());
+
+      const auto add = [&](const vertex_index vi) {
+        if (local_index[vi] != not_in_tile)
+          return;
+
+        local_index[vi] = checked_index<std::uint32_t>(tile.vertices.size());
+        tile.vertices.push_back(vi);
+      };
+
+      // ring k consists of the neighbors of ring k - 1 which aren't part of the rings 0 to k - 1
+      for (size_t k = 1; k <= depth; ++k)
+      {
+        const auto ring_begin = k == 1 ? 0 : tile.ring_ends[k - 2];
+        const auto ring_end = tile.ring_ends[k - 1];
+
+        for (size_t j = ring_begin; j < ring_end; ++j)
+          std::ranges::for_each(adjacency[tile.vertices[j]], add);
+
+        tile.ring_ends.push_back(tile.vertices.size());
+      }
+
+      const auto num_smoothed = tile.ring_ends[depth - 1];
+      tile.offsets.reserve(num_smoothed + 1);
+      tile.offsets.push_back(0);
+
+      for (size_t j = 0; j < num_smoothed; ++j)
+      {
+        for (const auto neighbor : adjacency[tile.vertices[j]])
+          tile.neighbors.push_back(local_index[neighbor]);
+
+        tile.offsets.push_back(checked_index<std::uint32_t>(tile.neighbors.size()));
+      }
+
+      for (const auto vi : tile.vertices)
+        local_index[vi] = not_in_tile;
+
+      return tile;
+    }
+  }  // namespace
+
+  std::vector<smoothing_tile> make_smoothing_tiles(const adjacency_view& adjacency, const size_t num_vertices,
+                                                   const size_t tile_size, const size_t depth,
+                                                   const size_t num_threads)
+  {
+    auto patches = make_patches(adjacency, num_vertices, tile_size);
+
+    const auto num_tiles = patches.size();
+    const auto num_tasks = std::min(num_threads, std::max<size_t>(num_tiles, 1));
+
+    std::vector<smoothing_tile> tiles(num_tiles);
+
+    parallel_invoke_n(num_tasks, [&](const size_t task) {
+      std::vector<std::uint32_t> local_index(num_vertices, not_in_tile);
+
+      for (size_t ti = num_tiles * task / num_tasks; ti < num_tiles * (task + 1) / num_tasks; ++ti)
+        tiles[ti] = make_tile(adjacency, std::move(patches[ti]), depth, local_index);
+    });
+
+    return tiles;
+  }
+
+  smoothing_tile make_range_tile(const adjacency_view& adjacency, const size_t first, const size_t last,
+                                 const size_t depth, std::pmr::memory_resource* const resource)
+  {
+    const auto in_patch = [&](const vertex_index vi) { return vi >= first && vi < last; };
+    const auto patch = std::views::iota(first, last);
+
+    // rings[k] holds the global indices of ring k in ascending order, ring 0 is the patch
+    std::pmr::vector<std::pmr::vector<vertex_index>> rings(depth + 1, resource);
+
+    const auto add_ring = [&](const size_t k, const auto& previous_ring) {
+      auto& ring = rings[k];
+
+      size_t num_candidates = 0;
+      for (const auto vi : previous_ring)
+        num_candidates += adjacency[vi].size();
+      ring.reserve(num_candidates);
+
+      for (const auto vi : previous_ring)
+        std::ranges::copy_if(adjacency[vi], std::back_inserter(ring), std::not_fn(in_patch));
+
+      std::ranges::sort(ring);
+      const auto [last_unique, end] = std::ranges::unique(ring);
+      ring.erase(last_unique, end);
+
+      // the neighbors of ring k - 1 are part of the rings k - 2 to k
+      const auto in_ring = [&](const size_t j, const vertex_index vi) {
+        return j > 0 && std::ranges::binary_search(rings[j], vi);
+      };
+      std::erase_if(ring, [&](const vertex_index vi) { return in_ring(k - 1, vi) || (k > 1 && in_ring(k - 2, vi)); });
+    };
+
+    add_ring(1, patch);
+    for (size_t k = 2; k <= depth; ++k)
+      add_ring(k, rings[k - 1]);
+
+    smoothing_tile tile{resource};
+    tile.ring_ends.reserve(depth + 1);
+    tile.ring_ends.push_back(last - first);
+    for (size_t k = 1; k <= depth; ++k)
+      tile.ring_ends.push_back(tile.ring_ends.back() + rings[k].size());
+
+    tile.vertices.reserve(tile.ring_ends.back());
+    std::ranges::transform(patch, std::back_inserter(tile.vertices), &narrow_index<vertex_index>);
+    for (size_t k = 1; k <= depth; ++k)
+      tile.vertices.insert(tile.vertices.end(), rings[k].begin(), rings[k].end());
+
+    const auto local_index = [&](const vertex_index vi) {
+      if (in_patch(vi))
+        return checked_index<std::uint32_t>(vi - first);
+
+      // the vertex is part of one of the rings, otherwise it wouldn't be a neighbor of a vertex within distance
+      // depth - 1
+      for (size_t k = 1;; ++k)
+      {
+        const auto it = std::ranges::lower_bound(rings[k], vi);
+        if (it != rings[k].end() && *it == vi)
+          return checked_index<std::uint32_t>(tile.ring_ends[k - 1] + static_cast<size_t>(it - rings[k].begin()));
+      }
+    };
+
+    const auto num_smoothed = tile.ring_ends[depth - 1];
+    size_t num_neighbors = 0;
+    for (size_t j = 0; j < num_smoothed; ++j)
+      num_neighbors += adjacency[tile.vertices[j]].size();
+
+    tile.offsets.reserve(num_smoothed + 1);
+    tile.offsets.push_back(0);
+    tile.neighbors.reserve(num_neighbors);
+
+    for (size_t j = 0; j < num_smoothed; ++j)
+    {
+      std::ranges::transform(adjacency[tile.vertices[j]], std::back_inserter(tile.neighbors), local_index);
+      tile.offsets.push_back(checked_index<std::uint32_t>(tile.neighbors.size()));
+    }
+
+    return tile;
+  }
+
+  std::span<const vec3f> advance_tile(const smoothing_tile& tile, const size_t num_iterations,
+                                      const std::span<const vec3f> org_vertices, tile_buffers& buffers)
+  {
+    auto& org = buffers.org;
+    auto& smoothed = buffers.smoothed;
+
+    org.resize(tile.vertices.size());
+    smoothed.resize(tile.vertices.size());
+    std::ranges::transform(tile.vertices, org.begin(), [&](const vertex_index vi) { return org_vertices[vi]; });
+
+    // iteration t only has to smooth the vertices within distance num_iterations - t of the patch: their neighbors
+    // are within distance num_iterations - t + 1 and have been smoothed by iteration t - 1
+    for (size_t t = 1; t <= num_iterations; ++t)
+    {
+      const auto num_smoothed = tile.ring_ends[num_iterations - t];
+
+      for (size_t j = 0; j < num_smoothed; ++j)
+      {
+        const auto neighbors =
+          std::span{tile.neighbors}.subspan(tile.offsets[j], tile.offsets[j + 1] - tile.offsets[j]);
+        smoothed[j] = averaged_neighbors(j, neighbors, org);
+      }
+
+      std::swap(org, smoothed);
+    }
+
+    return std::span{org}.first(tile.ring_ends[0]);
+  }
+
+  void smooth_tile(const smoothing_tile& tile, const size_t num_iterations, const std::span<const vec3f> org_vertices,
+                   const std::span<vec3f> smoothed_vertices, tile_buffers& buffers)
+  {
+    const auto patch_positions = advance_tile(tile, num_iterations, org_vertices, buffers);
+
+    // the patches are disjoint, so the workers never write the same position
+    for (size_t j = 0; j < patch_positions.size(); ++j)
+      smoothed_vertices[tile.vertices[j]] = patch_positions[j];
+  }
+}  // namespace quxflux::detail
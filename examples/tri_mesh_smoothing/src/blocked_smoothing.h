@@ -0,0 +1,71 @@
+#pragma once
+
+#include "tri_mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+namespace quxflux::detail
+{
+  // a compact patch of vertices together with the rings of vertices around it which are required to advance the
+  // positions of the patch by up to depth iterations without reading any position computed by another tile
+  struct smoothing_tile
+  {
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    explicit smoothing_tile(const allocator_type& alloc = {})
+      : vertices(alloc), ring_ends(alloc), offsets(alloc), neighbors(alloc)
+    {}
+
+    // global indices of the patch's vertices followed by the halo rings 1 to depth
+    std::pmr::vector<vertex_index> vertices;
+    // ring_ends[k] is the number of vertices within graph distance k of the patch, ring_ends[0] the patch size
+    std::pmr::vector<size_t> ring_ends;
+    // adjacency of the vertices within distance depth - 1 in tile local indices, which need less memory than
+    // global ones and keep more of the tile in cache
+    std::pmr::vector<std::uint32_t> offsets;
+    std::pmr::vector<std::uint32_t> neighbors;
+  };
+
+  // partitions the vertices into compact patches of up to tile_size vertices, grown by breadth first search, and
+  // surrounds each one with depth (> 0) halo rings. The halo rings are built using num_threads threads.
+  std::vector<smoothing_tile> make_smoothing_tiles(const adjacency_view& adjacency, size_t num_vertices,
+                                                   size_t tile_size, size_t depth, size_t num_threads);
+
+  // the tiles of a mesh as kept in its adjacency_cache. Tiles with more halo rings than required can be advanced by
+  // fewer iterations as well.
+  struct smoothing_tiling
+  {
+    size_t tile_size = 0;
+    size_t depth = 0;
+    std::vector<smoothing_tile> tiles;
+  };
+
+  // the tile whose patch consists of the vertices [first, last), surrounded by depth (> 0) halo rings. The rings are
+  // found by sorting and merging instead of a lookup table of all vertices, so the memory required is proportional to
+  // the size of the tile. All of its memory, including the temporaries, is allocated from resource.
+  smoothing_tile make_range_tile(const adjacency_view& adjacency, size_t first, size_t last, size_t depth,
+                                 std::pmr::memory_resource* resource);
+
+  // per worker scratch memory of smooth_tile, kept alive across the tiles to avoid reallocations
+  struct tile_buffers
+  {
+    explicit tile_buffers(std::pmr::memory_resource* const resource) : org(resource), smoothed(resource) {}
+
+    std::pmr::vector<vec3f> org;
+    std::pmr::vector<vec3f> smoothed;
+  };
+
+  // returns the positions of the patch's vertices after num_iterations (at most depth) iterations starting from
+  // org_vertices, which are stored in buffers. The results are bit-identical to performing the iterations one by one
+  // on the whole mesh.
+  std::span<const vec3f> advance_tile(const smoothing_tile& tile, size_t num_iterations,
+                                      std::span<const vec3f> org_vertices, tile_buffers& buffers);
+
+  // writes the positions computed by advance_tile to smoothed_vertices
+  void smooth_tile(const smoothing_tile& tile, size_t num_iterations, std::span<const vec3f> org_vertices,
+                   std::span<vec3f> smoothed_vertices, tile_buffers& buffers);
+}  // namespace quxflux::detail
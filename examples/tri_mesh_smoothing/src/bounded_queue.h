@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace quxflux::detail
+{
+  struct queue_statistics
+  {
+    size_t capacity = 0;
+    size_t max_occupancy = 0;
+    // number of queued elements averaged over the lifetime of the queue
+    double average_occupancy = 0;
+  };
+
+  // queue which holds at most capacity elements and may be used by multiple producers and consumers. push blocks
+  // while the queue is full, pop while it is empty, until the queue is closed.
+  template<typename T>
+  class bounded_queue
+  {
+  public:
+    explicit bounded_queue(const size_t capacity) : elements_(std::max<size_t>(capacity, 1)) {}
+
+    // returns false and drops value if the queue has been closed
+    bool push(T value)
+    {
+      {
+        std::unique_lock lock{mutex_};
+        not_full_.wait(lock, [&] { return closed_ || size_ < elements_.size(); });
+
+        if (closed_)
+          return false;
+
+        record_occupancy();
+        elements_[(first_ + size_) % elements_.size()].emplace(std::move(value));
+        max_occupancy_ = std::max(max_occupancy_, ++size_);
+      }
+
+      not_empty_.notify_one();
+      return true;
+    }
+
+    // returns std::nullopt once the queue has been closed and all remaining elements have been popped
+    std::optional<T> pop()
+    {
+      std::optional<T> value;
+      {
+        std::unique_lock lock{mutex_};
+        not_empty_.wait(lock, [&] { return closed_ || size_ > 0; });
+
+        if (size_ == 0)
+          return std::nullopt;
+
+        record_occupancy();
+        value = std::exchange(elements_[first_], std::nullopt);
+        first_ = (first_ + 1) % elements_.size();
+        --size_;
+      }
+
+      not_full_.notify_one();
+      return value;
+    }
+
+    // wakes all waiting threads, the following pushes fail
+    void close()
+    {
+      {
+        std::scoped_lock lock{mutex_};
+        closed_ = true;
+      }
+
+      not_full_.notify_all();
+      not_empty_.notify_all();
+    }
+
+    queue_statistics statistics() const
+    {
+      std::scoped_lock lock{mutex_};
+
+      const auto now = clock::now();
+      const auto integral = occupancy_integral_ + static_cast<double>(size_) * seconds(now - last_change_);
+      const auto lifetime = seconds(now - created_);
+
+      return {.capacity = elements_.size(),
+              .max_occupancy = max_occupancy_,
+              .average_occupancy = lifetime > 0 ? integral / lifetime : 0};
+    }
+
+  private:
+    using clock = std::chrono::steady_clock;
+
+    static double seconds(const clock::duration duration) { return std::chrono::duration<double>(duration).count(); }
+
+    // integrates the occupancy over time, must be invoked before every change of the size
+    void record_occupancy()
+    {
+      const auto now = clock::now();
+      occupancy_integral_ += static_cast<double>(size_) * seconds(now - last_change_);
+      last_change_ = now;
+    }
+
+    mutable std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+    // ring buffer of size_ elements starting at first_
+    std::vector<std::optional<T>> elements_;
+    size_t first_ = 0;
+    size_t size_ = 0;
+    bool closed_ = false;
+
+    size_t max_occupancy_ = 0;
+    const clock::time_point created_ = clock::now();
+    clock::time_point last_change_ = created_;
+    double occupancy_integral_ = 0;
+  };
+}  // namespace quxflux::detail
@@ -1,83 +1,641 @@
 #include "laplacian_smoothing.h"
 
+#include "adjacency_cache.h"
+#include "blocked_smoothing.h"
+#include "inline_buffer_resource.h"
+#include "parallel.h"
+#include "soa_smoothing.h"
 #include "tri_mesh.h"
+#include "tri_mesh_impl.h"
+#include "vertex_averaging.h"
 
 #include <algorithm>
+#include <barrier>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
 #include <functional>
+#include <memory>
 #include <memory_resource>
+#include <numeric>
+#include <optional>
+#include <ranges>
 #include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace quxflux
 {
   namespace
   {
-    vec3f get_vertex(const tri_mesh& mesh, const vertex_index i)
+    // memory owned by a single worker, kept alive across all iterations
+    struct worker_memory
     {
-      vec3f vertex{};
-      mesh.get_vertex(i, vertex.data());
-      return vertex;
-    }
+      explicit worker_memory(std::pmr::memory_resource* const upstream) : pool(upstream) {}
+
+      // serves the buffers which outgrow the local storage of the allocation strategies (e.g. use_pmr_vector for
+      // vertices with a valence > 6), so they never contend between the workers
+      std::pmr::unsynchronized_pool_resource pool;
+      // backing storage of the use_arena strategy
+      std::pmr::vector<std::byte> arena_storage{&pool};
+      // scratch memory of the temporally blocked kernel
+      detail::tile_buffers tile_buffers{&pool};
+      // number of buffers which didn't fit into the local storage of the allocation strategy in this iteration
+      size_t num_spills = 0;
+    };
+
+    // the number of neighbor indices the buffer of an use_inline_buffer strategy holds, 0 for other strategies
+    template<typename AllocationStrategy>
+    constexpr size_t inline_buffer_capacity = 0;
+
+    template<size_t Capacity>
+    constexpr size_t inline_buffer_capacity<allocation_strategy::detail::use_inline_buffer_t<Capacity>> = Capacity;
 
     template<typename AllocationStrategy>
-    vec3f smoothed_vertex(const tri_mesh& mesh, const vertex_index i, const std::span<const vec3f> org_vertices)
+    vec3f smoothed_vertex(const tri_mesh& mesh, const std::optional<adjacency_view>& adjacency, const vertex_index i,
+                          const std::span<const vec3f> org_vertices, std::pmr::memory_resource* const upstream,
+                          size_t& num_spills)
+    {
+      if constexpr (std::same_as<AllocationStrategy, allocation_strategy::detail::use_mesh_view_t>)
+      {
+        // zero-copy implementation:
+        // the neighbor indices are read directly from the storage of the mesh, no buffer is required at all
+        if (adjacency)
+          return detail::averaged_neighbors(i, (*adjacency)[i], org_vertices);
+
+        return smoothed_vertex<allocation_strategy::detail::use_pmr_vector_t>(mesh, adjacency, i, org_vertices,
+                                                                              upstream, num_spills);
+      } else
+      {
+        const auto n = mesh.get_vertex_valence(i);
+
+        if constexpr (std::same_as<AllocationStrategy, allocation_strategy::detail::use_vector_t>)
+        {
+          // naive implementation:
+          // create a regular vector each time the function is called, resulting in a heap allocation
+          // each time
+          std::vector<vertex_index> neighbor_indices(n);
+          mesh.get_vertex_neighbors(i, neighbor_indices.data(), n);
+          return detail::averaged_neighbors(i, neighbor_indices, org_vertices);
+        } else if constexpr (inline_buffer_capacity<AllocationStrategy> > 0)
+        {
+          // optimized implementation using std::pmr::vector:
+          // use a resource with a buffer on the stack which holds space for the neighbors of the vertices with a
+          // valence up to the capacity (6 suffice for most vertices of a regular triangulation). Larger buffers are
+          // requested from upstream.
+          inline_buffer_resource<sizeof(vertex_index) * inline_buffer_capacity<AllocationStrategy>> buf_resource{
+            upstream};
+          std::pmr::vector<vertex_index> neighbor_indices(n, &buf_resource);
+          mesh.get_vertex_neighbors(i, neighbor_indices.data(), n);
+          num_spills += buf_resource.num_spills();
+          return detail::averaged_neighbors(i, neighbor_indices, org_vertices);
+        } else if constexpr (std::same_as<AllocationStrategy, allocation_strategy::detail::use_arena_t>)
+        {
+          // arena implementation:
+          // upstream is the arena of the worker, the caller makes sure that it has room for the buffer
+          std::pmr::vector<vertex_index> neighbor_indices(n, upstream);
+          mesh.get_vertex_neighbors(i, neighbor_indices.data(), n);
+          return detail::averaged_neighbors(i, neighbor_indices, org_vertices);
+        }
+      }
+    }
+
+    template<typename VertexRange>
+    void smooth_in_arena(const tri_mesh& mesh, const VertexRange& vertices, const std::span<const vec3f> org_vertices,
+                         const std::span<vec3f> smoothed_vertices,
+                         const allocation_strategy::detail::use_arena_t& strategy, worker_memory& memory)
     {
-      const auto n = mesh.get_vertex_valence(i);
+      auto& storage = memory.arena_storage;
+      if (storage.size() < strategy.arena_size)
+        storage.resize(strategy.arena_size);
+
+      // the arena has no upstream: running out of space is a bug and must not silently fall back to the heap
+      std::optional<std::pmr::monotonic_buffer_resource> arena;
+      arena.emplace(storage.data(), storage.size(), std::pmr::null_memory_resource());
+      size_t arena_used = 0;
+
+      for (const vertex_index vi : vertices)
+      {
+        const auto n_bytes = mesh.get_vertex_valence(vi) * sizeof(vertex_index);
 
-      if (n == 0) [[unlikely]]
-        return get_vertex(mesh, i);
+        if (arena_used + n_bytes > storage.size())
+        {
+          // releasing rewinds the arena to the start of its storage
+          arena->release();
+          arena_used = 0;
 
-      const auto calculate_smoothed = [&](const std::span<const vertex_index> neighbor_indices) {
-        vec3f smoothed{};
+          if (n_bytes > storage.size())
+          {
+            ++memory.num_spills;
+            storage.resize(std::max(n_bytes, 2 * storage.size()));
+            arena.emplace(storage.data(), storage.size(), std::pmr::null_memory_resource());
+          }
+        }
 
-        for (const auto vi : neighbor_indices)
-          std::ranges::transform(smoothed, org_vertices[vi], smoothed.begin(), std::plus<>{});
+        arena_used += n_bytes;
+        smoothed_vertices[vi] =
+          smoothed_vertex<allocation_strategy::detail::use_arena_t>(mesh, std::nullopt, vi, org_vertices, &*arena,
+                                                                    memory.num_spills);
+      }
+
+      arena->release();
+    }
+
+    // smoothes the given vertices using one of the allocation strategies
+    template<typename Strategy, typename VertexRange>
+    void smooth_vertices(const tri_mesh& mesh, const std::optional<adjacency_view>& adjacency,
+                         const VertexRange& vertices, const std::span<const vec3f> org_vertices,
+                         const std::span<vec3f> smoothed_vertices, const Strategy& strategy, worker_memory& memory)
+    {
+      if constexpr (std::same_as<Strategy, allocation_strategy::detail::use_arena_t>)
+      {
+        smooth_in_arena(mesh, vertices, org_vertices, smoothed_vertices, strategy, memory);
+      } else
+      {
+        for (const vertex_index vi : vertices)
+          smoothed_vertices[vi] =
+            smoothed_vertex<Strategy>(mesh, adjacency, vi, org_vertices, &memory.pool, memory.num_spills);
+      }
+    }
+
+    std::pmr::memory_resource* upstream_resource(const smoothing_options& options)
+    {
+      return options.upstream_resource ? options.upstream_resource : std::pmr::get_default_resource();
+    }
 
-        const auto n_recip = 1.f / static_cast<float>(n);
-        std::ranges::transform(smoothed, smoothed.begin(), std::bind_front(std::multiplies<>{}, n_recip));
+    auto vertex_range(const size_t first, const size_t last)
+    {
+      return std::views::iota(detail::narrow_index<vertex_index>(first), detail::narrow_index<vertex_index>(last));
+    }
+
+    // performs up to num_iterations iterations, each one split across the workers. prepare_iteration and
+    // finish_iteration are invoked on a single thread before respectively after each iteration. prepare_iteration
+    // returns the number of work items of the iteration, smooth_range is invoked by every worker with its slice
+    // [first, last) of the work items and the worker's memory. finish_iteration may complete the statistics of the
+    // iteration which are then passed to options.on_iteration. The iterations stop early once finish_iteration
+    // returns false. If any of them throws, the iterations stop once every worker reached the end of the current one
+    // and the exception is rethrown (the one of the worker with the lowest index if several threw).
+    template<typename PrepareIteration, typename SmoothRange, typename FinishIteration>
+    void run_iterations(const size_t n, const size_t num_iterations, const smoothing_options& options,
+                        PrepareIteration prepare_iteration, SmoothRange smooth_range,
+                        FinishIteration finish_iteration)
+    {
+      using clock = std::chrono::steady_clock;
 
-        return smoothed;
+      const size_t num_threads = std::min(detail::resolve_num_threads(options.num_threads), std::max<size_t>(n, 1));
+      const auto upstream = upstream_resource(options);
+
+      if (num_iterations == 0)
+        return;
+
+      auto iteration_start = clock::now();
+      size_t num_items = prepare_iteration();
+
+      // the memory of each worker lives on the worker's thread, the completion step only reads the spill counters
+      std::vector<worker_memory*> memories(num_threads);
+      // a worker which threw keeps arriving at the barrier until the others stopped, the last slot receives the
+      // exceptions of the completion step
+      std::vector<std::exception_ptr> exceptions(num_threads + 1);
+
+      // every vertex only reads the positions of the previous iteration, so the vertex range can be split across
+      // the workers without any synchronization except for the barrier at the end of each iteration. The
+      // completion step of the barrier runs on exactly one thread while the others wait, it has to be noexcept.
+      size_t iteration = 0;
+      bool done = false;
+      std::barrier sync{static_cast<std::ptrdiff_t>(num_threads), [&]() noexcept {
+                          if (std::ranges::any_of(exceptions, [](const auto& e) { return e != nullptr; }))
+                          {
+                            done = true;
+                            return;
+                          }
+
+                          try
+                          {
+                            smoothing_iteration_statistics stats{.iteration = iteration,
+                                                                 .num_active_vertices = num_items};
+                            for (auto* const memory : memories)
+                              stats.num_spills += std::exchange(memory->num_spills, 0);
+
+                            const bool proceed = finish_iteration(stats);
+
+                            stats.duration = clock::now() - iteration_start;
+                            if (options.on_iteration)
+                              options.on_iteration(stats);
+
+                            done = !proceed || ++iteration == num_iterations;
+
+                            if (!done)
+                            {
+                              iteration_start = clock::now();
+                              num_items = prepare_iteration();
+                            }
+                          }
+                          catch (...)
+                          {
+                            exceptions.back() = std::current_exception();
+                            done = true;
+                          }
+                        }};
+
+      const auto work = [&](const size_t worker_index) {
+        std::optional<worker_memory> memory;
+
+        try
+        {
+          memories[worker_index] = &memory.emplace(upstream);
+        }
+        catch (...)
+        {
+          exceptions[worker_index] = std::current_exception();
+        }
+
+        while (!done)
+        {
+          if (!exceptions[worker_index])
+          {
+            try
+            {
+              smooth_range(num_items * worker_index / num_threads, num_items * (worker_index + 1) / num_threads,
+                           *memory);
+            }
+            catch (...)
+            {
+              exceptions[worker_index] = std::current_exception();
+            }
+          }
+
+          sync.arrive_and_wait();
+        }
       };
 
-      if constexpr (std::same_as<AllocationStrategy, allocation_strategy::detail::use_vector_t>)
       {
-        // naive implementation:
-        // create a regular vector each time the function is called, resulting in a heap allocation
-        // each time
-        std::vector<vertex_index> neighbor_indices(n);
-        mesh.get_vertex_neighbors(i, neighbor_indices.data(), n);
-        return calculate_smoothed(neighbor_indices);
-      } else if constexpr (std::same_as<AllocationStrategy, allocation_strategy::detail::use_pmr_vector_t>)
+        std::vector<std::jthread> workers;
+
+        try
+        {
+          workers.reserve(num_threads - 1);
+
+          for (size_t worker_index = 1; worker_index < num_threads; ++worker_index)
+            workers.emplace_back(work, worker_index);
+        }
+        catch (...)
+        {
+          // the workers which didn't start leave the barrier, so the started ones stop after the first iteration
+          // instead of waiting for them forever
+          exceptions.front() = std::current_exception();
+          for (size_t worker_index = workers.size() + 1; worker_index < num_threads; ++worker_index)
+            sync.arrive_and_drop();
+        }
+
+        work(0);
+      }
+
+      for (const auto& e : exceptions)
+        if (e)
+          std::rethrow_exception(e);
+    }
+
+    template<typename Strategy>
+    constexpr bool is_smoothing_kernel = std::same_as<Strategy, smoothing_kernel::detail::soa_simd_t> ||
+                                         std::same_as<Strategy, smoothing_kernel::detail::temporally_blocked_t>;
+
+    void laplacian_smoothing_soa(tri_mesh& mesh, const size_t num_iterations,
+                                 const smoothing_kernel::detail::soa_simd_t& kernel, const smoothing_options& options)
+    {
+      const size_t n = mesh.get_num_vertices();
+      const auto instruction_set = detail::resolve_instruction_set(kernel.instruction_set, n);
+
+      // the faces don't change while smoothing, so the adjacency has to be fetched (or copied) only once
+      std::optional<detail::adjacency_storage> copied_adjacency;
+      auto adjacency = mesh.adjacency();
+      if (!adjacency)
+        adjacency = copied_adjacency.emplace(mesh).view();
+
+      const auto lane_adjacency = detail::make_lane_adjacency(instruction_set, *adjacency);
+
+      const bool ping_pong = options.buffering == vertex_buffering::ping_pong;
+
+      std::vector<vec3f> vertices(n);
+      detail::soa_vertices org_vertices;
+      detail::soa_vertices smoothed_vertices;
+      smoothed_vertices.assign(vertices);
+
+      const auto load_vertices = [&] {
+        mesh.get_vertices(0, vertices);
+        org_vertices.assign(vertices);
+      };
+
+      if (ping_pong)
+        load_vertices();
+
+      run_iterations(
+        n, num_iterations, options,
+        [&] {
+          if (!ping_pong)
+            load_vertices();
+          return n;
+        },
+        [&](const size_t first, const size_t last, worker_memory&) {
+          detail::smooth_soa(instruction_set, *adjacency, lane_adjacency, std::as_const(org_vertices).view(),
+                             smoothed_vertices.view(), detail::narrow_index<vertex_index>(first),
+                             detail::narrow_index<vertex_index>(last));
+        },
+        [&](smoothing_iteration_statistics&) {
+          if (ping_pong)
+          {
+            std::swap(org_vertices, smoothed_vertices);
+          } else
+          {
+            smoothed_vertices.copy_to(vertices);
+            mesh.set_vertices(0, vertices);
+          }
+          return true;
+        });
+
+      if (ping_pong && num_iterations > 0)
       {
-        // optimized implementation using std::pmr::vector:
-        // use a monotonic_buffer_resource with a preallocated stack-based buffer which holds space for
-        // 6 vertices (which should be sufficient for most vertices).
-        std::array<std::byte, sizeof(vertex_index) * 6> static_storage;
-        std::pmr::monotonic_buffer_resource buf_resource{static_storage.data(), static_storage.size()};
-        std::pmr::vector<vertex_index> neighbor_indices(n, &buf_resource);
-        mesh.get_vertex_neighbors(i, neighbor_indices.data(), n);
-        return calculate_smoothed(neighbor_indices);
+        org_vertices.copy_to(vertices);
+        mesh.set_vertices(0, vertices);
       }
     }
+
+    void laplacian_smoothing_blocked(tri_mesh& mesh, const size_t num_iterations,
+                                     const smoothing_kernel::detail::temporally_blocked_t& kernel,
+                                     const smoothing_options& options)
+    {
+      const size_t n = mesh.get_num_vertices();
+      const auto depth = std::max<size_t>(kernel.iterations_per_pass, 1);
+
+      if (num_iterations == 0)
+        return;
+
+      std::optional<detail::adjacency_storage> copied_adjacency;
+      auto adjacency = mesh.adjacency();
+      if (!adjacency)
+        adjacency = copied_adjacency.emplace(mesh).view();
+
+      // tiles which are only advanced by fewer iterations need fewer halo rings
+      const auto tile_size = std::max<size_t>(kernel.tile_size, 1);
+      const auto tile_depth = std::min(depth, num_iterations);
+      const auto make_tiling = [&] {
+        return detail::smoothing_tiling{.tile_size = tile_size,
+                                        .depth = tile_depth,
+                                        .tiles = detail::make_smoothing_tiles(
+                                          *adjacency, n, tile_size, tile_depth,
+                                          detail::resolve_num_threads(options.num_threads))};
+      };
+
+      // building the tiles costs several plain iterations, meshes which provide a cache keep them for later calls
+      std::shared_ptr<const detail::smoothing_tiling> tiling;
+      if (auto* const cache = mesh.adjacency_cache())
+        tiling = cache->get_or_make<detail::smoothing_tiling>(
+          [&](const detail::smoothing_tiling& cached) {
+            return cached.tile_size == tile_size && cached.depth >= tile_depth;
+          },
+          make_tiling);
+      else
+        tiling = std::make_shared<const detail::smoothing_tiling>(make_tiling());
+
+      const auto& tiles = tiling->tiles;
+
+      std::pmr::vector<vec3f> org_vertices(n, upstream_resource(options));
+      std::pmr::vector<vec3f> smoothed_vertices(n, upstream_resource(options));
+      mesh.get_vertices(0, org_vertices);
+
+      // every pass advances all tiles by depth iterations, the last one by the remaining ones
+      size_t remaining_iterations = num_iterations;
+
+      run_iterations(
+        tiles.size(), (num_iterations + depth - 1) / depth, options, [&] { return tiles.size(); },
+        [&](const size_t first, const size_t last, worker_memory& memory) {
+          for (size_t ti = first; ti < last; ++ti)
+            detail::smooth_tile(tiles[ti], std::min(depth, remaining_iterations), org_vertices, smoothed_vertices,
+                                memory.tile_buffers);
+        },
+        [&](smoothing_iteration_statistics& stats) {
+          // the work items of the blocked kernel are tiles, each pass performs several iterations
+          stats.num_active_vertices = n;
+          remaining_iterations -= std::min(depth, remaining_iterations);
+          org_vertices.swap(smoothed_vertices);
+          return true;
+        });
+
+      mesh.set_vertices(0, org_vertices);
+    }
+
+    float squared_distance(const vec3f& a, const vec3f& b)
+    {
+      float sum = 0;
+      for (size_t i = 0; i < 3; ++i)
+        sum += (a[i] - b[i]) * (a[i] - b[i]);
+
+      return sum;
+    }
+
+    // smoothing restricted to the active vertices: the vertices which moved by more than the tolerance in the
+    // previous iteration and their neighbors. Every other vertex would (approximately) stay in place.
+    template<typename Strategy>
+    void laplacian_smoothing_active_set(tri_mesh& mesh, const size_t num_iterations, const Strategy& strategy,
+                                        const smoothing_options& options)
+    {
+      const size_t n = mesh.get_num_vertices();
+
+      // the mesh isn't modified until the end, so its views stay valid and the adjacency needs to be fetched once
+      std::optional<detail::adjacency_storage> copied_adjacency;
+      auto adjacency = mesh.adjacency();
+      if (!adjacency)
+        adjacency = copied_adjacency.emplace(mesh).view();
+
+      const auto upstream = upstream_resource(options);
+
+      std::pmr::vector<vec3f> positions(n, upstream);
+      mesh.get_vertices(0, positions);
+      std::pmr::vector<vec3f> smoothed_positions(n, upstream);
+
+      std::pmr::vector<vertex_index> active_vertices(n, upstream);
+      std::ranges::copy(vertex_range(0, n), active_vertices.begin());
+      std::pmr::vector<vertex_index> next_active_vertices(upstream);
+
+      // one byte per vertex (instead of std::vector<bool>) so that the workers may write the flags concurrently
+      std::pmr::vector<std::uint8_t> moved(n, 0, upstream);
+      std::pmr::vector<std::uint8_t> marked(n, 0, upstream);
+
+      const auto squared_tolerance = options.displacement_tolerance * options.displacement_tolerance;
+
+      // the smoothing kernels work on contiguous vertex ranges, the scattered active vertices are smoothed using the
+      // adjacency directly which yields exactly the same positions
+      using vertex_strategy = std::conditional_t<is_smoothing_kernel<Strategy>,
+                                                 allocation_strategy::detail::use_mesh_view_t, Strategy>;
+      const auto vertex_strategy_instance = [&] {
+        if constexpr (std::same_as<vertex_strategy, Strategy>)
+          return strategy;
+        else
+          return vertex_strategy{};
+      }();
+      const auto strategy_adjacency =
+        std::same_as<vertex_strategy, allocation_strategy::detail::use_mesh_view_t> ? adjacency : std::nullopt;
+
+      run_iterations(
+        n, num_iterations, options, [&] { return active_vertices.size(); },
+        [&](const size_t first, const size_t last, worker_memory& memory) {
+          const auto vertices = std::span{active_vertices}.subspan(first, last - first);
+          smooth_vertices(mesh, strategy_adjacency, vertices, positions, smoothed_positions,
+                          vertex_strategy_instance, memory);
+
+          for (const auto vi : vertices)
+            moved[vi] = squared_distance(smoothed_positions[vi], positions[vi]) > squared_tolerance;
+        },
+        [&](smoothing_iteration_statistics& stats) {
+          next_active_vertices.clear();
+
+          // the next active set is collected by scanning the flags in order if it is likely to be dense, which is
+          // much cheaper than sorting it. Sparse sets are collected while marking the vertices and sorted.
+          const bool dense = active_vertices.size() > n / 16;
+
+          const auto activate = [&](const vertex_index vi) {
+            if (!std::exchange(marked[vi], std::uint8_t{1}) && !dense)
+              next_active_vertices.push_back(vi);
+          };
+
+          for (const auto vi : active_vertices)
+          {
+            positions[vi] = smoothed_positions[vi];
+
+            if (!std::exchange(moved[vi], std::uint8_t{0}))
+              continue;
+
+            ++stats.num_moved_vertices;
+            activate(vi);
+            std::ranges::for_each((*adjacency)[vi], activate);
+          }
+
+          // keep the active vertices sorted for locality and to split them evenly across the workers
+          if (dense)
+          {
+            for (const auto vi : vertex_range(0, n))
+              if (std::exchange(marked[vi], std::uint8_t{0}))
+                next_active_vertices.push_back(vi);
+          } else
+          {
+            std::ranges::sort(next_active_vertices);
+            for (const auto vi : next_active_vertices)
+              marked[vi] = 0;
+          }
+
+          active_vertices.swap(next_active_vertices);
+
+          return !active_vertices.empty();
+        });
+
+      mesh.set_vertices(0, positions);
+    }
   }  // namespace
 
-  template<typename AllocationStrategy>
-  void laplacian_smoothing(tri_mesh& mesh, const size_t num_iterations, const AllocationStrategy&)
+  size_t allocation_strategy::select_inline_buffer_capacity(const std::span<const size_t> valence_histogram,
+                                                            const double share)
   {
-    const size_t n = mesh.get_num_vertices();
-    std::vector<vec3f> org_vertices(n);
+    const auto num_vertices = std::accumulate(valence_histogram.begin(), valence_histogram.end(), size_t{0});
 
-    for (size_t i = 0; i < num_iterations; ++i)
+    for (const auto capacity : inline_buffer_capacities)
     {
-      std::ranges::copy(mesh_vertices(mesh), org_vertices.begin());
+      const auto fitting = valence_histogram.first(std::min(capacity + 1, valence_histogram.size()));
+      const auto num_fitting = std::accumulate(fitting.begin(), fitting.end(), size_t{0});
 
-      for (size_t vi = 0; vi < n; ++vi)
-        mesh.set_vertex(vi, smoothed_vertex<AllocationStrategy>(mesh, vi, org_vertices).data());
+      if (static_cast<double>(num_fitting) >= share * static_cast<double>(num_vertices))
+        return capacity;
+    }
+
+    return inline_buffer_capacities.back();
+  }
+
+  template<typename Strategy>
+  void laplacian_smoothing(tri_mesh& mesh, const size_t num_iterations, const Strategy& strategy,
+                           const smoothing_options& options)
+  {
+    if (options.displacement_tolerance > 0)
+    {
+      laplacian_smoothing_active_set(mesh, num_iterations, strategy, options);
+    } else if constexpr (std::same_as<Strategy, smoothing_kernel::detail::soa_simd_t>)
+    {
+      laplacian_smoothing_soa(mesh, num_iterations, strategy, options);
+    } else if constexpr (std::same_as<Strategy, smoothing_kernel::detail::temporally_blocked_t>)
+    {
+      laplacian_smoothing_blocked(mesh, num_iterations, strategy, options);
+    } else
+    {
+      const size_t n = mesh.get_num_vertices();
+      const bool ping_pong = options.buffering == vertex_buffering::ping_pong;
+
+      std::pmr::vector<vec3f> org_vertices(n, upstream_resource(options));
+      std::pmr::vector<vec3f> smoothed_vertices(n, upstream_resource(options));
+      std::optional<adjacency_view> adjacency;
+
+      // in ping_pong mode the mesh isn't modified until the end, so the views stay valid across all iterations
+      const auto load_vertices = [&] {
+        mesh.get_vertices(0, org_vertices);
+
+        // the adjacency view is only used by use_mesh_view, so don't bother the mesh for other strategies
+        if constexpr (std::same_as<Strategy, allocation_strategy::detail::use_mesh_view_t>)
+          adjacency = mesh.adjacency();
+      };
+
+      if (ping_pong)
+        load_vertices();
+
+      run_iterations(
+        n, num_iterations, options,
+        [&] {
+          if (!ping_pong)
+            load_vertices();
+          return n;
+        },
+        [&](const size_t first, const size_t last, worker_memory& memory) {
+          smooth_vertices(mesh, adjacency, vertex_range(first, last), org_vertices, smoothed_vertices, strategy,
+                          memory);
+        },
+        [&](smoothing_iteration_statistics&) {
+          if (ping_pong)
+            org_vertices.swap(smoothed_vertices);
+          else
+            mesh.set_vertices(0, smoothed_vertices);
+          return true;
+        });
+
+      if (ping_pong && num_iterations > 0)
+        mesh.set_vertices(0, org_vertices);
     }
   }
 
   template void laplacian_smoothing<allocation_strategy::detail::use_vector_t>  //
-    (tri_mesh&, size_t, const allocation_strategy::detail::use_vector_t&);
+    (tri_mesh&, size_t, const allocation_strategy::detail::use_vector_t&, const smoothing_options&);
+
+  template void laplacian_smoothing<allocation_strategy::detail::use_inline_buffer_t<4>>  //
+    (tri_mesh&, size_t, const allocation_strategy::detail::use_inline_buffer_t<4>&, const smoothing_options&);
+
+  template void laplacian_smoothing<allocation_strategy::detail::use_inline_buffer_t<6>>  //
+    (tri_mesh&, size_t, const allocation_strategy::detail::use_inline_buffer_t<6>&, const smoothing_options&);
+
+  template void laplacian_smoothing<allocation_strategy::detail::use_inline_buffer_t<8>>  //
+    (tri_mesh&, size_t, const allocation_strategy::detail::use_inline_buffer_t<8>&, const smoothing_options&);
+
+  template void laplacian_smoothing<allocation_strategy::detail::use_inline_buffer_t<12>>  //
+    (tri_mesh&, size_t, const allocation_strategy::detail::use_inline_buffer_t<12>&, const smoothing_options&);
+
+  template void laplacian_smoothing<allocation_strategy::detail::use_inline_buffer_t<16>>  //
+    (tri_mesh&, size_t, const allocation_strategy::detail::use_inline_buffer_t<16>&, const smoothing_options&);
+
+  template void laplacian_smoothing<allocation_strategy::detail::use_mesh_view_t>  //
+    (tri_mesh&, size_t, const allocation_strategy::detail::use_mesh_view_t&, const smoothing_options&);
+
+  template void laplacian_smoothing<allocation_strategy::detail::use_arena_t>  //
+    (tri_mesh&, size_t, const allocation_strategy::detail::use_arena_t&, const smoothing_options&);
+
+  template void laplacian_smoothing<smoothing_kernel::detail::soa_simd_t>  //
+    (tri_mesh&, size_t, const smoothing_kernel::detail::soa_simd_t&, const smoothing_options&);
 
-  template void laplacian_smoothing<allocation_strategy::detail::use_pmr_vector_t>  //
-    (tri_mesh&, size_t, const allocation_strategy::detail::use_pmr_vector_t&);
+  template void laplacian_smoothing<smoothing_kernel::detail::temporally_blocked_t>  //
+    (tri_mesh&, size_t, const smoothing_kernel::detail::temporally_blocked_t&, const smoothing_options&);
 }  // namespace quxflux
@@ -1,5 +1,15 @@
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
 namespace quxflux
 {
   struct tri_mesh;
@@ -10,14 +20,155 @@ namespace quxflux
     {
       // clang-format off
       struct use_vector_t {};
-      struct use_pmr_vector_t {};
+      template<size_t Capacity> struct use_inline_buffer_t {};
+      struct use_mesh_view_t {};
       // clang-format on
+
+      using use_pmr_vector_t = use_inline_buffer_t<6>;
+
+      struct use_arena_t
+      {
+        // capacity of each worker's arena in bytes, it is grown if a single vertex doesn't fit
+        size_t arena_size = 64 * 1024;
+      };
     }  // namespace detail
 
     static constexpr detail::use_vector_t use_vector;
+    // copies the neighbor indices into a std::pmr::vector allocated from a buffer on the stack which holds Capacity
+    // indices, the buffers of vertices with a higher valence spill to the worker's pool. Instantiated for the
+    // capacities in inline_buffer_capacities.
+    template<size_t Capacity>
+    static constexpr detail::use_inline_buffer_t<Capacity> use_inline_buffer{};
+    // use_inline_buffer<6>, which holds the neighbors of the vertices of a regular triangulation
     static constexpr detail::use_pmr_vector_t use_pmr_vector;
+    // reads the neighbor indices directly from the adjacency view of the mesh without copying them if the mesh
+    // provides one, falls back to use_pmr_vector otherwise
+    static constexpr detail::use_mesh_view_t use_mesh_view;
+    // bump allocates the neighbor buffers of consecutive vertices from a per worker arena which is released as a
+    // whole once it is exhausted and at the end of each iteration. Never allocates from the heap after the first
+    // iteration, regardless of the vertex valences.
+    static constexpr detail::use_arena_t use_arena{};
+
+    inline constexpr std::array<size_t, 5> inline_buffer_capacities{4, 6, 8, 12, 16};
+
+    // the smallest of inline_buffer_capacities which holds the neighbors of at least the given share of the vertices,
+    // the largest one if none does. valence_histogram[v] is the number of vertices of valence v (see
+    // vertex_valence_histogram).
+    size_t select_inline_buffer_capacity(std::span<const size_t> valence_histogram, double share = 0.99);
+
+    // invokes f(use_inline_buffer<capacity>), throws std::invalid_argument if capacity is not one of
+    // inline_buffer_capacities
+    template<typename F>
+    void visit_inline_buffer(const size_t capacity, F&& f)
+    {
+      const bool found = [&]<size_t... I>(std::index_sequence<I...>) {
+        const auto visit = [&]<size_t Capacity>(const detail::use_inline_buffer_t<Capacity>& strategy) {
+          if (capacity != Capacity)
+            return false;
+
+          f(strategy);
+          return true;
+        };
+
+        return (visit(use_inline_buffer<inline_buffer_capacities[I]>) || ...);
+      }(std::make_index_sequence<inline_buffer_capacities.size()>{});
+
+      if (!found)
+        throw std::invalid_argument("no inline buffer of capacity " + std::to_string(capacity));
+    }
   }  // namespace allocation_strategy
 
-  template<typename AllocationStrategy>
-  void laplacian_smoothing(tri_mesh& mesh, const size_t iterations, const AllocationStrategy&);
+  enum class simd_instruction_set
+  {
+    best_available,
+    avx2,
+    sse,
+    scalar
+  };
+
+  namespace smoothing_kernel
+  {
+    namespace detail
+    {
+      struct soa_simd_t
+      {
+        // requesting an instruction set which is not supported by the cpu falls back to the next narrower one
+        simd_instruction_set instruction_set = simd_instruction_set::best_available;
+      };
+
+      struct temporally_blocked_t
+      {
+        // maximum number of vertices per tile, excluding the halo. A tile including its halo, both position buffers
+        // and its adjacency takes about 64 bytes per vertex, the default fits into a 2 MiB L2 cache.
+        size_t tile_size = 16384;
+        // number of iterations each tile is advanced by before moving on to the next one
+        size_t iterations_per_pass = 4;
+      };
+    }  // namespace detail
+
+    // transposes the vertex positions into structure-of-arrays layout and smoothes several vertices at once, one
+    // per simd lane. The instruction set is chosen at runtime.
+    static constexpr detail::soa_simd_t soa_simd{};
+    // splits the mesh into compact tiles surrounded by halo rings and advances each tile by several iterations while
+    // its positions are in cache, instead of streaming all positions and the adjacency through the cache once per
+    // iteration. The halo vertices are smoothed redundantly by the neighboring tiles, so the results are exactly the
+    // same as the ones of the other strategies. Building the tiles costs about as much as a call of 10 plain
+    // iterations, they are kept in the adjacency_cache of the mesh (shared with its copies) for later calls. Only
+    // pays off once the tiles are cached and the mesh exceeds the caches (subdivision levels 9 to 11), the first call
+    // is slower than use_mesh_view.
+    static constexpr detail::temporally_blocked_t temporally_blocked{};
+  }  // namespace smoothing_kernel
+
+  enum class vertex_buffering
+  {
+    // reads the positions from the mesh before and writes them back after every iteration
+    copy_per_iteration,
+    // reads the positions once, alternates between two buffers and writes the result back after the last iteration
+    ping_pong
+  };
+
+  struct smoothing_iteration_statistics
+  {
+    // the temporally blocked kernel reports one entry per pass of several iterations
+    size_t iteration = 0;
+    // number of vertices which were smoothed in this iteration
+    size_t num_active_vertices = 0;
+    // number of vertices which moved by more than the displacement tolerance, only counted if
+    // displacement_tolerance is greater than 0
+    size_t num_moved_vertices = 0;
+    // number of neighbor buffers which didn't fit into the local storage of the allocation strategy and were
+    // allocated from the worker's pool instead (use_inline_buffer: valence > capacity, use_arena: the arena had to
+    // grow)
+    size_t num_spills = 0;
+    std::chrono::nanoseconds duration{};
+  };
+
+  struct smoothing_options
+  {
+    // number of worker threads the vertex range is split across, 0 selects std::thread::hardware_concurrency()
+    size_t num_threads = 1;
+    // how the positions are passed between the iterations, both yield the same result. Ignored by the
+    // temporally blocked kernel and if displacement_tolerance is greater than 0, which always use ping_pong buffers.
+    vertex_buffering buffering = vertex_buffering::ping_pong;
+    // if greater than 0, an iteration only smoothes the vertices which moved by more than this distance in the
+    // previous iteration and their neighbors, all other vertices keep their position. Smoothing stops early once
+    // no vertex moved by more than the tolerance. The smoothing kernels compute the scattered active vertices one by
+    // one.
+    float displacement_tolerance = 0;
+    // invoked after each iteration on one of the worker threads while the other workers wait. If it throws, the
+    // smoothing stops and laplacian_smoothing rethrows the exception.
+    std::function<void(const smoothing_iteration_statistics&)> on_iteration;
+    // the position buffers and the per worker pools, which serve the buffers exceeding the local storage of the
+    // allocation strategies, allocate from this resource. The buffers of the soa kernel and the tiles of the
+    // temporally blocked kernel are allocated from the heap. nullptr selects std::pmr::get_default_resource(). Must
+    // be thread-safe if num_threads is not 1.
+    std::pmr::memory_resource* upstream_resource = nullptr;
+  };
+
+  // Strategy is either one of the allocation strategies or one of the smoothing kernels. If an exception is thrown
+  // on any of the worker threads, the workers stop after the current iteration and the exception is rethrown, the
+  // positions of the mesh are unspecified then.
+  template<typename Strategy>
+  void laplacian_smoothing(tri_mesh& mesh, const size_t iterations, const Strategy&,
+                           const smoothing_options& options = {});
 }  // namespace quxflux
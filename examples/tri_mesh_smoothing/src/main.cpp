@@ -1,58 +1,552 @@
 #include "tri_mesh.h"
+#include "batch_processing.h"
 #include "laplacian_smoothing.h"
+#include "out_of_core_smoothing.h"
+#include "tracking_mem_resource.h"
+
+#ifdef QUXFLUX_COUNTING_OPERATOR_NEW
+#include "global_allocation_counter.h"
+#endif
 
 #include <algorithm>
+#include <charconv>
 #include <chrono>
+#include <cstddef>
 #include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
 #include <functional>
 #include <iostream>
-#include <numeric>
+#include <memory_resource>
 #include <ranges>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 namespace
 {
   namespace qf = quxflux;
 
+  template<typename Duration = std::chrono::milliseconds, typename Func>
+  auto measure(Func&& f)
+  {
+    const auto start = std::chrono::high_resolution_clock::now();
+    f();
+    return std::chrono::duration_cast<Duration>(std::chrono::high_resolution_clock::now() - start);
+  }
+
+  // the obj writer as it was implemented before switching to std::to_chars, kept as reference for the benchmark
+  void write_to_file_using_ostream(const qf::tri_mesh& mesh, const std::filesystem::path& path)
+  {
+    std::ofstream ofs;
+    ofs.exceptions(std::ios_base::failbit);
+    ofs.open(path);
+
+    for (auto v : mesh_vertices(mesh))
+      ofs << "v " << v[0] << ' ' << v[1] << ' ' << v[2] << '\n';
+
+    for (auto f : mesh_faces(mesh))
+    {
+      // vertex indices in obj are 1-based
+      std::ranges::transform(f, f.begin(), std::bind_front(std::plus<>{}, size_t{1}));
+      ofs << "f " << f[0] << ' ' << f[1] << ' ' << f[2] << '\n';
+    }
+  }
+
+  template<typename AllocationStrategy, typename Duration = std::chrono::milliseconds>
+  auto smooth(qf::tri_mesh& mesh, const AllocationStrategy& allocation_strategy,
+              const qf::smoothing_options& options = {})
+  {
+    return measure<Duration>([&] { qf::laplacian_smoothing(mesh, 10, allocation_strategy, options); });
+  }
+
   template<typename AllocationStrategy, typename Duration = std::chrono::milliseconds>
   auto smooth(const qf::tri_mesh& mesh, const AllocationStrategy& allocation_strategy,
               const std::filesystem::path& output_path)
   {
     const auto copy = mesh.clone();
-
-    const auto start = std::chrono::high_resolution_clock::now();
-    qf::laplacian_smoothing(*copy.get(), 10, allocation_strategy);
-    const auto dur = std::chrono::duration_cast<Duration>(std::chrono::high_resolution_clock::now() - start);
+    const auto dur = smooth<AllocationStrategy, Duration>(*copy.get(), allocation_strategy);
     // exclude IO from measurement
     qf::write_to_file(*copy.get(), output_path);
     return dur;
   }
 
-  double calculate_average_vertex_valence(const qf::tri_mesh& mesh)
+  double calculate_average_vertex_valence(const std::vector<size_t>& valence_histogram)
+  {
+    size_t num_vertices = 0;
+    size_t sum_of_valences = 0;
+    for (size_t valence = 0; valence < valence_histogram.size(); ++valence)
+    {
+      num_vertices += valence_histogram[valence];
+      sum_of_valences += valence * valence_histogram[valence];
+    }
+
+    return static_cast<double>(sum_of_valences) / static_cast<double>(std::max<size_t>(num_vertices, 1));
+  }
+
+  template<typename AllocationStrategy>
+  void report_thread_scaling(const qf::tri_mesh& mesh, const AllocationStrategy& allocation_strategy)
+  {
+    std::vector<size_t> thread_counts{1, 2, 4, 8, std::max(size_t{1}, size_t{std::thread::hardware_concurrency()})};
+    std::ranges::sort(thread_counts);
+    const auto [last, end] = std::ranges::unique(thread_counts);
+    thread_counts.erase(last, end);
+
+    std::vector<qf::vec3f> serial_result;
+    std::chrono::milliseconds serial_duration{};
+
+    for (const auto num_threads : thread_counts)
+    {
+      const auto copy = mesh.clone();
+      const auto dur = smooth(*copy.get(), allocation_strategy, {.num_threads = num_threads});
+
+      std::vector<qf::vec3f> result(copy->get_num_vertices());
+      copy->get_vertices(0, result);
+
+      if (num_threads == 1)
+      {
+        serial_result = std::move(result);
+        serial_duration = dur;
+        std::cout << "  1 thread took " << dur << '\n';
+        continue;
+      }
+
+      const auto speedup = static_cast<double>(serial_duration.count()) / static_cast<double>(dur.count());
+
+      std::cout << "  " << num_threads << " threads took " << dur << " (speedup " << speedup << "x, "
+                << (result == serial_result ? "identical to" : "DIFFERS from") << " the serial result)\n";
+    }
+  }
+
+  struct allocation_snapshot
+  {
+    size_t n_upstream_allocations = 0;
+    size_t n_global_allocations = 0;
+  };
+
+  allocation_snapshot take_allocation_snapshot(const qf::tracking_mem_resource& upstream)
+  {
+    allocation_snapshot snapshot{.n_upstream_allocations = upstream.get_statistics().n_allocations};
+#ifdef QUXFLUX_COUNTING_OPERATOR_NEW
+    snapshot.n_global_allocations = qf::get_global_allocation_counts().n_allocations;
+#endif
+    return snapshot;
+  }
+
+  // smoothes a copy of the mesh and reports the allocations from the upstream resource of the smoothing, the spills
+  // of the neighbor buffers and (if available) all allocations through the global operator new. The allocations
+  // after the end of the first iteration show whether the hot loop is allocation-free once the pools are warmed up.
+  template<typename Strategy>
+  void report_allocations(const qf::tri_mesh& mesh, const char* const name, const Strategy& strategy)
+  {
+    static constexpr size_t num_iterations = 10;
+
+    const auto copy = mesh.clone();
+    qf::tracking_mem_resource upstream;
+    size_t num_spills = 0;
+    allocation_snapshot after_first_iteration;
+    allocation_snapshot after_last_iteration;
+
+#ifdef QUXFLUX_COUNTING_OPERATOR_NEW
+    const auto global_before = qf::get_global_allocation_counts();
+#endif
+
+    qf::laplacian_smoothing(*copy.get(), num_iterations, strategy,
+                            {.on_iteration =
+                               [&](const qf::smoothing_iteration_statistics& stats) {
+                                 num_spills += stats.num_spills;
+                                 after_last_iteration = take_allocation_snapshot(upstream);
+                                 if (stats.iteration == 0)
+                                   after_first_iteration = after_last_iteration;
+                               },
+                             .upstream_resource = &upstream});
+
+    const auto upstream_stats = upstream.get_statistics();
+
+    std::cout << "  " << name << ": " << upstream_stats.n_allocations << " allocations from upstream (peak "
+              << (upstream_stats.peak_is_upper_bound ? "at most " : "")
+              << static_cast<float>(upstream_stats.peak_bytes_in_use) / 1024 << " KiB), " << num_spills << " spills";
+#ifdef QUXFLUX_COUNTING_OPERATOR_NEW
+    const auto global_after = qf::get_global_allocation_counts();
+    std::cout << ", " << global_after.n_allocations - global_before.n_allocations << " calls of operator new ("
+              << static_cast<float>(global_after.n_bytes_allocated - global_before.n_bytes_allocated) / 1024
+              << " KiB)";
+#endif
+    std::cout << "\n    after the first iteration: "
+              << after_last_iteration.n_upstream_allocations - after_first_iteration.n_upstream_allocations
+              << " allocations from upstream";
+#ifdef QUXFLUX_COUNTING_OPERATOR_NEW
+    std::cout << ", " << after_last_iteration.n_global_allocations - after_first_iteration.n_global_allocations
+              << " calls of operator new";
+#endif
+    std::cout << '\n';
+  }
+
+  constexpr std::string_view batch_usage = R"(usage: tri_mesh_smoothing [options] <file or directory>...
+
+smoothes the given .obj and .bin mesh files and the ones in the given directories, loading, smoothing and writing
+the meshes concurrently. Without arguments a demo on a generated sphere is run instead.
+
+options:
+  --output=<directory>      directory the smoothed meshes are written to under their file names, which have to be
+                            unique (required)
+  --list=<path>             additionally smooth the mesh files listed in <path>, one per line
+  --iterations=<n>          smoothing iterations per mesh (default: 10)
+  --threads=<n>             smoothing threads, 0 selects all hardware threads (default: 1)
+  --queue-capacity=<n>      maximum number of meshes waiting between two stages (default: 2)
+)";
+
+  size_t parse_number(const std::string_view str)
+  {
+    size_t value = 0;
+    const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+
+    if (ec != std::errc{} || ptr != str.data() + str.size())
+      throw std::invalid_argument("expected a non-negative number, got '" + std::string{str} + "'");
+
+    return value;
+  }
+
+  struct batch_command_line
+  {
+    qf::batch_options options;
+    std::vector<std::filesystem::path> paths;
+  };
+
+  batch_command_line parse_batch_command_line(const int argc, char** argv)
+  {
+    batch_command_line cl;
+
+    for (int i = 1; i < argc; ++i)
+    {
+      const std::string_view arg{argv[i]};
+
+      if (!arg.starts_with("--"))
+      {
+        cl.paths.emplace_back(arg);
+        continue;
+      }
+
+      const auto separator = arg.find('=');
+      if (separator == std::string_view::npos)
+        throw std::invalid_argument("invalid argument '" + std::string{arg} + "'");
+
+      const auto key = arg.substr(2, separator - 2);
+      const auto value = arg.substr(separator + 1);
+
+      if (key == "output")
+        cl.options.output_directory = value;
+      else if (key == "list")
+      {
+        std::ifstream ifs{std::filesystem::path{value}};
+        if (!ifs)
+          throw std::invalid_argument("can't open the list '" + std::string{value} + "'");
+
+        for (std::string line; std::getline(ifs, line);)
+          if (!line.empty())
+            cl.paths.emplace_back(line);
+      } else if (key == "iterations")
+        cl.options.iterations = parse_number(value);
+      else if (key == "threads")
+        cl.options.num_smoothing_threads = parse_number(value);
+      else if (key == "queue-capacity")
+        cl.options.queue_capacity = parse_number(value);
+      else
+        throw std::invalid_argument("unknown option '" + std::string{key} + "'");
+    }
+
+    if (cl.options.output_directory.empty())
+      throw std::invalid_argument("the output directory is required");
+
+    if (cl.paths.empty())
+      throw std::invalid_argument("no mesh files given");
+
+    return cl;
+  }
+
+  double seconds(const std::chrono::nanoseconds duration) { return std::chrono::duration<double>(duration).count(); }
+
+  // the throughput of a stage refers to the time it was busy, i.e. what the stage could sustain on its own
+  void report_stage(const std::string_view name, const qf::batch_stage_statistics& stage,
+                    const std::chrono::nanoseconds duration, const double amount, const std::string_view unit)
   {
-    const auto vertex_valences = std::views::iota(size_t{0}, mesh.get_num_vertices())  //
-                                 | std::views::transform(std::bind_front(&qf::tri_mesh::get_vertex_valence, &mesh));
+    const auto share = [&](const std::chrono::nanoseconds part) {
+      return duration.count() > 0 ? 100.0 * seconds(part) / seconds(duration) : 0.0;
+    };
+
+    std::cout << "  " << name << ": " << stage.num_meshes << " meshes, "
+              << (stage.busy.count() > 0 ? amount / seconds(stage.busy) : 0.0) << ' ' << unit << " while busy, busy "
+              << share(stage.busy) << "%, waiting for input " << share(stage.waiting_for_input)
+              << "%, waiting for output " << share(stage.waiting_for_output) << "%, " << stage.num_heap_allocations
+              << " heap allocations\n";
+  }
+
+  void report_queue(const std::string_view name, const qf::detail::queue_statistics& queue)
+  {
+    std::cout << "  queue " << name << ": average occupancy " << queue.average_occupancy << " of " << queue.capacity
+              << ", max " << queue.max_occupancy << '\n';
+  }
+
+  int run_batch(const int argc, char** argv)
+  {
+    batch_command_line cl;
+    std::vector<std::filesystem::path> inputs;
+
+    try
+    {
+      cl = parse_batch_command_line(argc, argv);
+      inputs = qf::collect_mesh_files(cl.paths);
+    }
+    catch (const std::exception& e)
+    {
+      std::cerr << e.what() << "\n\n" << batch_usage;
+      return EXIT_FAILURE;
+    }
+
+    qf::batch_statistics stats;
 
-    return static_cast<double>(
-             std::accumulate(std::ranges::begin(vertex_valences), std::ranges::end(vertex_valences), size_t{0})) /
-           static_cast<double>(mesh.get_num_vertices());
+    try
+    {
+      stats = qf::smooth_mesh_files(inputs, cl.options);
+    }
+    catch (const std::exception& e)
+    {
+      std::cerr << e.what() << '\n';
+      return EXIT_FAILURE;
+    }
+
+    static constexpr double mib = 1024 * 1024;
+
+    std::cout.setf(std::ios_base::fixed, std::ios_base::floatfield);
+    std::cout.precision(1);
+    std::cout << "smoothed " << stats.write.num_meshes << " of " << inputs.size() << " meshes ("
+              << static_cast<double>(stats.write.num_vertices) / 1e6 << "M vertices) in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(stats.duration) << '\n';
+    report_stage("load", stats.load, stats.duration, static_cast<double>(stats.load.num_bytes) / mib, "MiB/s");
+    report_stage("smooth", stats.smooth, stats.duration,
+                 static_cast<double>(stats.smooth.num_vertices * cl.options.iterations) / 1e6, "M vertex updates/s");
+    report_stage("write", stats.write, stats.duration, static_cast<double>(stats.write.num_bytes) / mib, "MiB/s");
+    report_queue("load -> smooth", stats.loaded_queue);
+    report_queue("smooth -> write", stats.smoothed_queue);
+
+    for (const auto& failure : stats.failures)
+      std::cerr << "failed to smooth " << failure.path << ": " << failure.what << '\n';
+
+    return stats.failures.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
   }
 }  // namespace
 
-int main()
+int main(int argc, char** argv)
 {
-  const auto sphere = qf::generate_noisy_unit_sphere(9, 0.01f);
+  // with arguments the given mesh files are smoothed in batch mode instead of running the demo
+  if (argc > 1)
+    return run_batch(argc, argv);
 
+  const auto sphere = qf::generate_noisy_unit_sphere(9, 0.01f, 0);
+
+  std::cout.setf(std::ios_base::fixed, std::ios_base::floatfield);
   std::cout.precision(1);
   std::cout << "mesh is built up of " << sphere->get_num_vertices() << " vertices and " << sphere->get_num_faces()
             << " faces\n";
-  std::cout << "average vertex valence: " << calculate_average_vertex_valence(*sphere.get()) << "\n";
+  const auto valence_histogram = qf::vertex_valence_histogram(*sphere.get());
+  // the neighbors of the vertices with a higher valence spill from the inline buffer
+  const auto inline_buffer_capacity = qf::allocation_strategy::select_inline_buffer_capacity(valence_histogram);
+  std::cout << "average vertex valence: " << calculate_average_vertex_valence(valence_histogram)
+            << ", highest valence: " << valence_histogram.size() - 1
+            << ", inline buffer capacity for 99% of the vertices: " << inline_buffer_capacity << "\n";
+
+  std::cout << "writing noisy_sphere.obj using std::ofstream took "
+            << measure([&] { write_to_file_using_ostream(*sphere.get(), "noisy_sphere.obj"); }) << '\n';
+
+  for (const auto num_threads : {size_t{1}, size_t{0}})
+  {
+    const auto thread_desc = num_threads == 0 ? "all available threads" : "a single thread";
+
+    std::cout << "writing noisy_sphere.obj using " << thread_desc << " took "
+              << measure([&] { qf::write_to_file(*sphere.get(), "noisy_sphere.obj", num_threads); }) << '\n';
+
+    std::unique_ptr<qf::tri_mesh> read_sphere;
+    std::cout << "reading noisy_sphere.obj using " << thread_desc << " took "
+              << measure([&] { read_sphere = qf::read_from_file("noisy_sphere.obj", num_threads); }) << '\n';
+
+    if (!std::ranges::equal(qf::mesh_vertices(*read_sphere.get()), qf::mesh_vertices(*sphere.get())))
+      std::cout << "the mesh read from noisy_sphere.obj DIFFERS from the written one\n";
+  }
+
+  std::cout << "writing noisy_sphere.bin took "
+            << measure([&] { qf::write_binary(*sphere.get(), "noisy_sphere.bin"); }) << '\n';
+  {
+    std::unique_ptr<qf::tri_mesh> mapped_sphere;
+    std::cout << "mapping noisy_sphere.bin took "
+              << measure<std::chrono::microseconds>([&] { mapped_sphere = qf::read_binary("noisy_sphere.bin"); })
+              << '\n';
+
+    if (!std::ranges::equal(qf::mesh_vertices(*mapped_sphere.get()), qf::mesh_vertices(*sphere.get())) ||
+        !std::ranges::equal(qf::mesh_faces(*mapped_sphere.get()), qf::mesh_faces(*sphere.get())))
+      std::cout << "the mesh mapped from noisy_sphere.bin DIFFERS from the written one\n";
+  }
+
+  {
+    // the storage of a clone can be allocated from an arena which is sized to hold the whole mesh: cloning then
+    // allocates a single block from upstream, which is released as a whole instead of per vector
+    qf::tracking_mem_resource heap;
+    std::unique_ptr<qf::tri_mesh> heap_clone;
+    const auto heap_dur = measure([&] { heap_clone = sphere->clone(&heap); });
+    heap_clone.reset();
+
+    // slack for the padding between the blocks
+    const auto mesh_size = heap.get_statistics().n_bytes_allocated + 4 * alignof(std::max_align_t);
 
-  qf::write_to_file(*sphere.get(), "noisy_sphere.obj");
+    qf::tracking_mem_resource arena_upstream;
+    std::unique_ptr<qf::tri_mesh> arena_clone;
+    std::chrono::milliseconds arena_dur{};
+    {
+      std::pmr::monotonic_buffer_resource arena{mesh_size, &arena_upstream};
+      arena_dur = measure([&] { arena_clone = sphere->clone(&arena); });
+
+      if (!std::ranges::equal(qf::mesh_vertices(*arena_clone.get()), qf::mesh_vertices(*sphere.get())) ||
+          !std::ranges::equal(qf::mesh_faces(*arena_clone.get()), qf::mesh_faces(*sphere.get())))
+        std::cout << "the mesh cloned into an arena DIFFERS from the original one\n";
+
+      arena_clone.reset();
+    }
+
+    const auto heap_stats = heap.get_statistics();
+    const auto arena_stats = arena_upstream.get_statistics();
+    std::cout << "cloning the mesh took " << heap_dur << " (" << heap_stats.n_allocations
+              << " allocations), cloning it into an arena took " << arena_dur << " (" << arena_stats.n_allocations
+              << " allocations of " << static_cast<float>(arena_stats.n_bytes_allocated) / (1024 * 1024)
+              << " MiB from upstream, " << arena_stats.n_deallocations << " deallocations)\n";
+  }
 
   std::cout << "impl with std::vector took "
             << smooth(*sphere.get(), qf::allocation_strategy::use_vector, "smoothed_sphere_0.obj") << '\n';
   std::cout << "impl with std::pmr::vector took "
             << smooth(*sphere.get(), qf::allocation_strategy::use_pmr_vector, "smoothed_sphere_2.obj") << '\n';
+  std::cout << "impl with per worker arena took "
+            << smooth(*sphere.get(), qf::allocation_strategy::use_arena, "smoothed_sphere_7.obj") << '\n';
+  std::cout << "impl with zero-copy mesh view took "
+            << smooth(*sphere.get(), qf::allocation_strategy::use_mesh_view, "smoothed_sphere_3.obj") << '\n';
+  std::cout << "soa kernel (scalar) took "
+            << smooth(*sphere.get(), qf::smoothing_kernel::detail::soa_simd_t{qf::simd_instruction_set::scalar},
+                      "smoothed_sphere_4.obj")
+            << '\n';
+  std::cout << "soa kernel (sse) took "
+            << smooth(*sphere.get(), qf::smoothing_kernel::detail::soa_simd_t{qf::simd_instruction_set::sse},
+                      "smoothed_sphere_5.obj")
+            << '\n';
+  std::cout << "soa kernel (best available) took "
+            << smooth(*sphere.get(), qf::smoothing_kernel::soa_simd, "smoothed_sphere_6.obj") << '\n';
+  std::cout << "temporally blocked kernel took "
+            << smooth(*sphere.get(), qf::smoothing_kernel::temporally_blocked, "smoothed_sphere_9.obj") << '\n';
+
+  {
+    const auto copy = sphere->clone();
+    std::cout << "impl with zero-copy mesh view copying the vertices in every iteration took "
+              << smooth(*copy.get(), qf::allocation_strategy::use_mesh_view,
+                        {.buffering = qf::vertex_buffering::copy_per_iteration})
+              << '\n';
+    qf::write_to_file(*copy.get(), "smoothed_sphere_8.obj");
+  }
+
+  {
+    const auto reordered_sphere = sphere->clone();
+    std::vector<qf::vertex_index> new_to_old;
+    std::cout << "reordering the vertices (including the rebuild of the adjacency) took "
+              << measure([&] {
+                   new_to_old = qf::reorder_vertices(*reordered_sphere.get());
+                   static_cast<void>(reordered_sphere->adjacency());
+                 })
+              << '\n';
+
+    const auto blocked_sphere = reordered_sphere->clone();
+    qf::write_binary(*reordered_sphere.get(), "noisy_sphere_rcm.bin");
+    std::cout << "impl with zero-copy mesh view took "
+              << smooth(*reordered_sphere.get(), qf::allocation_strategy::use_mesh_view) << " on the reordered mesh\n";
+    std::cout << "temporally blocked kernel took "
+              << smooth(*blocked_sphere.get(), qf::smoothing_kernel::temporally_blocked) << " on the reordered mesh\n";
+
+    if (!std::ranges::equal(qf::mesh_vertices(*blocked_sphere.get()), qf::mesh_vertices(*reordered_sphere.get())))
+      std::cout << "the result of the temporally blocked kernel DIFFERS from the one of the mesh view impl\n";
+
+    // the chunks of the out-of-core smoothing are ranges of consecutive vertices, which are only spatially compact
+    // after reordering
+    {
+      static constexpr size_t memory_limit = size_t{32} << 20;
+
+      const auto stats = qf::laplacian_smoothing_out_of_core("noisy_sphere_rcm.bin", "smoothed_sphere_rcm.bin", 10,
+                                                             {.memory_limit = memory_limit});
+      const auto seconds = std::chrono::duration<double>(stats.duration).count();
+
+      std::cout << "out-of-core smoothing with a memory limit of " << (memory_limit >> 20) << " MiB took "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(stats.duration) << " on the reordered mesh ("
+                << stats.num_passes << " passes, " << stats.num_chunks << " chunks, "
+                << 100.0 * static_cast<double>(stats.num_halo_vertices) /
+                     static_cast<double>(stats.num_passes * sphere->get_num_vertices())
+                << "% halo vertices, " << static_cast<double>(stats.num_vertex_updates) / seconds / 1e6
+                << "M vertex updates/s, " << static_cast<double>(stats.num_bytes_read) / seconds / (1024 * 1024)
+                << " MiB/s read)\n";
+
+      if (!std::ranges::equal(qf::mesh_vertices(*qf::read_binary("smoothed_sphere_rcm.bin")),
+                              qf::mesh_vertices(*reordered_sphere.get())))
+        std::cout << "the result of out-of-core smoothing DIFFERS from the in-memory one\n";
+    }
+
+    // smoothing is independent of the vertex order, mapping the result back has to yield the original result
+    const auto original = sphere->clone();
+    smooth(*original.get(), qf::allocation_strategy::use_mesh_view);
+
+    const auto mapped_back = std::views::iota(size_t{0}, new_to_old.size()) | std::views::transform([&](const auto i) {
+                               qf::vec3f v;
+                               original->get_vertex(new_to_old[i], v.data());
+                               return v;
+                             });
+
+    if (!std::ranges::equal(qf::mesh_vertices(*reordered_sphere.get()), mapped_back))
+      std::cout << "the result of smoothing the reordered mesh DIFFERS from the original one\n";
+  }
+
+  std::cout << "allocations of 10 iterations on a single thread:\n";
+  report_allocations(*sphere.get(), "impl with std::vector", qf::allocation_strategy::use_vector);
+  report_allocations(*sphere.get(), "impl with std::pmr::vector", qf::allocation_strategy::use_pmr_vector);
+  qf::allocation_strategy::visit_inline_buffer(inline_buffer_capacity, [&](const auto& strategy) {
+    const auto name = "impl with std::pmr::vector and an inline buffer of " + std::to_string(inline_buffer_capacity) +
+                      " neighbors (selected from the valence histogram)";
+    report_allocations(*sphere.get(), name.c_str(), strategy);
+  });
+  report_allocations(*sphere.get(), "impl with per worker arena", qf::allocation_strategy::use_arena);
+  report_allocations(*sphere.get(), "impl with zero-copy mesh view", qf::allocation_strategy::use_mesh_view);
+  report_allocations(*sphere.get(), "soa kernel", qf::smoothing_kernel::soa_simd);
+  report_allocations(*sphere.get(), "temporally blocked kernel", qf::smoothing_kernel::temporally_blocked);
+
+  std::cout << "thread scaling of impl with std::pmr::vector:\n";
+  report_thread_scaling(*sphere.get(), qf::allocation_strategy::use_pmr_vector);
+
+  {
+    static constexpr size_t max_iterations = 100;
+    static constexpr float tolerance = 1e-4f;
+
+    size_t num_iterations = 0;
+    size_t num_vertex_updates = 0;
+    const auto copy = sphere->clone();
+    const auto dur = measure([&] {
+      qf::laplacian_smoothing(*copy.get(), max_iterations, qf::allocation_strategy::use_mesh_view,
+                              {.displacement_tolerance = tolerance,
+                               .on_iteration = [&](const qf::smoothing_iteration_statistics& stats) {
+                                 ++num_iterations;
+                                 num_vertex_updates += stats.num_active_vertices;
+                               }});
+    });
+
+    std::cout << "convergence-driven smoothing (tolerance 1e-4) took " << dur << " for "
+              << num_iterations << " iterations, smoothing "
+              << 100.0 * static_cast<double>(num_vertex_updates) /
+                   static_cast<double>(num_iterations * sphere->get_num_vertices())
+              << "% of the vertices per iteration on average\n";
+  }
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,137 @@
+#include "mapped_file.h"
+
+#include <string>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace quxflux::detail
+{
+  namespace
+  {
+    [[noreturn]] void throw_mapping_error(const std::filesystem::path& path)
+    {
+#ifdef _WIN32
+      const auto error = std::error_code{static_cast<int>(GetLastError()), std::system_category()};
+#else
+      const auto error = std::error_code{errno, std::generic_category()};
+#endif
+      throw std::system_error(error, "failed to map " + path.string());
+    }
+  }  // namespace
+
+#ifdef _WIN32
+  mapped_file::mapped_file(const std::filesystem::path& path, const access mode)
+  {
+    const bool cow = mode == access::copy_on_write;
+
+    // the view keeps the mapping and the file open, so both handles can be closed right after mapping
+    struct handle_closer
+    {
+      HANDLE handle;
+      ~handle_closer()
+      {
+        if (handle != nullptr && handle != INVALID_HANDLE_VALUE)
+          CloseHandle(handle);
+      }
+    };
+
+    const handle_closer file{CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                         FILE_ATTRIBUTE_NORMAL, nullptr)};
+    if (file.handle == INVALID_HANDLE_VALUE)
+      throw_mapping_error(path);
+
+    LARGE_INTEGER file_size{};
+    if (!GetFileSizeEx(file.handle, &file_size))
+      throw_mapping_error(path);
+
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    if (size_ == 0)
+      return;
+
+    const handle_closer mapping{
+      CreateFileMappingW(file.handle, nullptr, cow ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr)};
+    if (mapping.handle == nullptr)
+      throw_mapping_error(path);
+
+    data_ = static_cast<std::byte*>(MapViewOfFile(mapping.handle, cow ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr)
+      throw_mapping_error(path);
+  }
+
+  void mapped_file::unmap() noexcept
+  {
+    if (data_ != nullptr)
+      UnmapViewOfFile(data_);
+  }
+#else
+  mapped_file::mapped_file(const std::filesystem::path& path, const access mode)
+  {
+    // the mapping keeps the file open, so the descriptor can be closed right after mapping
+    struct fd_closer
+    {
+      int fd;
+      ~fd_closer()
+      {
+        if (fd >= 0)
+          close(fd);
+      }
+    };
+
+    const fd_closer file{open(path.c_str(), O_RDONLY)};
+    if (file.fd < 0)
+      throw_mapping_error(path);
+
+    struct stat file_stat
+    {};
+    if (fstat(file.fd, &file_stat) != 0)
+      throw_mapping_error(path);
+
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ == 0)
+      return;
+
+    const int protection = mode == access::copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* const mapping = mmap(nullptr, size_, protection, MAP_PRIVATE, file.fd, 0);
+    if (mapping == MAP_FAILED)
+      throw_mapping_error(path);
+
+    data_ = static_cast<std::byte*>(mapping);
+  }
+
+  void mapped_file::unmap() noexcept
+  {
+    if (data_ != nullptr)
+      munmap(data_, size_);
+  }
+#endif
+
+  mapped_file::mapped_file(mapped_file&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0))
+  {}
+
+  mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+  {
+    if (this != &other)
+    {
+      unmap();
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+    }
+
+    return *this;
+  }
+
+  mapped_file::~mapped_file() { unmap(); }
+}  // namespace quxflux::detail
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace quxflux::detail
+{
+  // memory mapping of a whole file
+  class mapped_file
+  {
+  public:
+    enum class access
+    {
+      read_only,
+      // the mapping is writable but modifications are private to the mapping and never written back to the file
+      copy_on_write
+    };
+
+    explicit mapped_file(const std::filesystem::path& path, access mode = access::read_only);
+    mapped_file(const mapped_file&) = delete;
+    mapped_file(mapped_file&& other) noexcept;
+    mapped_file& operator=(const mapped_file&) = delete;
+    mapped_file& operator=(mapped_file&& other) noexcept;
+    ~mapped_file();
+
+    std::span<const std::byte> data() const { return {data_, size_}; }
+
+    // only valid for mappings with copy_on_write access
+    std::span<std::byte> writable_data() { return {data_, size_}; }
+
+  private:
+    void unmap() noexcept;
+
+    std::byte* data_ = nullptr;
+    size_t size_ = 0;
+  };
+}  // namespace quxflux::detail
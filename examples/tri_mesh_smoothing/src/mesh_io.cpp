@@ -0,0 +1,396 @@
+#include "tri_mesh.h"
+
+#include "mapped_file.h"
+#include "parallel.h"
+#include "tri_mesh_impl.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace quxflux
+{
+  namespace
+  {
+    constexpr bool is_blank(const char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    std::string_view trim_leading_blanks(std::string_view s)
+    {
+      while (!s.empty() && is_blank(s.front()))
+        s.remove_prefix(1);
+
+      return s;
+    }
+
+    // removes and returns the next blank separated token of s, returns an empty string_view if there is none
+    std::string_view next_token(std::string_view& s)
+    {
+      s = trim_leading_blanks(s);
+
+      const auto end = std::min(s.size(), static_cast<size_t>(std::ranges::find_if(s, is_blank) - s.begin()));
+      const auto token = s.substr(0, end);
+      s.remove_prefix(end);
+
+      return token;
+    }
+
+    template<typename LineFunc>
+    void for_each_line(std::string_view text, LineFunc&& f)
+    {
+      while (!text.empty())
+      {
+        const auto eol = std::min(text.find('\n'), text.size());
+        f(text.substr(0, eol));
+        text.remove_prefix(std::min(eol + 1, text.size()));
+      }
+    }
+
+    enum class obj_statement
+    {
+      vertex,
+      face,
+      other
+    };
+
+    // classifies the statement in line and removes its keyword
+    obj_statement classify(std::string_view& line)
+    {
+      line = trim_leading_blanks(line);
+
+      if (line.size() < 2 || !is_blank(line[1]))
+        return obj_statement::other;
+
+      const auto keyword = line.front();
+      line.remove_prefix(2);
+
+      switch (keyword)
+      {
+        case 'v':
+          return obj_statement::vertex;
+        case 'f':
+          return obj_statement::face;
+        default:
+          return obj_statement::other;
+      }
+    }
+
+    // splits text into at most n parts of roughly equal size which all end at a line break
+    std::vector<std::string_view> split_at_line_breaks(const std::string_view text, const size_t n)
+    {
+      std::vector<std::string_view> chunks;
+      size_t first = 0;
+
+      for (size_t i = 1; i <= n && first < text.size(); ++i)
+      {
+        auto last = std::max(first, text.size() * i / n);
+        last = i == n ? text.size() : std::min(text.find('\n', last), text.size() - 1) + 1;
+
+        chunks.push_back(text.substr(first, last - first));
+        first = last;
+      }
+
+      return chunks;
+    }
+
+    [[noreturn]] void throw_parse_error(const std::string_view what, const std::string_view line)
+    {
+      throw std::runtime_error(std::string{what} + ": \"" + std::string{line} + '"');
+    }
+
+    struct obj_chunk
+    {
+      std::string_view text;
+
+      // number of vertices respectively triangles defined in this chunk and in all chunks before
+      size_t num_vertices = 0;
+      size_t num_triangles = 0;
+      size_t first_vertex = 0;
+      size_t first_face = 0;
+    };
+
+    void count_statements(obj_chunk& chunk)
+    {
+      for_each_line(chunk.text, [&](std::string_view line) {
+        switch (classify(line))
+        {
+          case obj_statement::vertex:
+            ++chunk.num_vertices;
+            break;
+          case obj_statement::face: {
+            // polygons are triangulated as fans
+            size_t num_face_vertices = 0;
+            while (!next_token(line).empty())
+              ++num_face_vertices;
+
+            chunk.num_triangles += std::max(num_face_vertices, size_t{2}) - 2;
+          }
+          break;
+          default:
+            break;
+        }
+      });
+    }
+
+    float parse_float(std::string_view token, const std::string_view line)
+    {
+      // from_chars doesn't accept an explicit positive sign
+      if (token.starts_with('+'))
+        token.remove_prefix(1);
+
+      float value{};
+      const auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+
+      if (ec != std::errc{} || ptr != token.data() + token.size())
+        throw_parse_error("malformed vertex definition", line);
+
+      return value;
+    }
+
+    // parses a face vertex reference of the form "v", "v/vt", "v//vn" or "v/vt/vn" and resolves it to a 0-based
+    // vertex index. Negative indices are relative to the number of vertices defined so far.
+    vertex_index parse_face_vertex(const std::string_view token, const size_t num_vertices_defined,
+                                   const size_t num_vertices_total, const std::string_view line)
+    {
+      std::int64_t index{};
+      const auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), index);
+
+      if (ec != std::errc{} || (ptr != token.data() + token.size() && *ptr != '/'))
+        throw_parse_error("malformed face definition", line);
+
+      const auto num_defined = static_cast<std::int64_t>(num_vertices_defined);
+      // vertex indices in obj are 1-based
+      const auto resolved = index > 0 ? index - 1 : num_defined + index;
+
+      if (index == 0 || resolved < 0 || static_cast<size_t>(resolved) >= num_vertices_total)
+        throw_parse_error("face refers to undefined vertex", line);
+
+      return static_cast<vertex_index>(resolved);
+    }
+
+    void parse_statements(const obj_chunk& chunk, const size_t num_vertices_total, const std::span<vec3f> vertices,
+                          const std::span<face> faces)
+    {
+      auto next_vertex = chunk.first_vertex;
+      auto next_face = chunk.first_face;
+
+      for_each_line(chunk.text, [&](const std::string_view line) {
+        auto statement = line;
+
+        switch (classify(statement))
+        {
+          case obj_statement::vertex: {
+            auto& v = vertices[next_vertex++];
+
+            // an optional fourth (w) component is ignored
+            for (auto& c : v)
+              c = parse_float(next_token(statement), line);
+          }
+          break;
+          case obj_statement::face: {
+            const auto next_face_vertex = [&] {
+              return parse_face_vertex(next_token(statement), next_vertex, num_vertices_total, line);
+            };
+
+            const auto first = next_face_vertex();
+            auto previous = next_face_vertex();
+
+            while (!trim_leading_blanks(statement).empty())
+            {
+              const auto current = next_face_vertex();
+              faces[next_face++] = {first, previous, current};
+              previous = current;
+            }
+          }
+          break;
+          default:
+            break;
+        }
+      });
+    }
+
+    // number of vertices respectively faces formatted into a buffer before it is written to the file
+    constexpr size_t elements_per_block = 1 << 16;
+
+    // reusable buffer which formats obj statements using std::to_chars
+    class format_buffer
+    {
+    public:
+      using allocator_type = std::pmr::polymorphic_allocator<>;
+
+      explicit format_buffer(const allocator_type& alloc = {}) : vertices(alloc), faces(alloc), chars_(alloc) {}
+
+      void clear() { size_ = 0; }
+
+      void append_vertex(const vec3f& v)
+      {
+        // "v " followed by three floats in shortest round-trip representation (which never exceeds
+        // max_float_chars characters) each one followed by a blank or the line break
+        reserve(2 + 3 * (max_float_chars + 1));
+        append("v ");
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+          append_number(v[i]);
+          append(i < 2 ? ' ' : '\n');
+        }
+      }
+
+      void append_face(const face& f)
+      {
+        reserve(2 + 3 * (max_index_chars + 1));
+        append("f ");
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+          // vertex indices in obj are 1-based
+          append_number(f[i] + 1);
+          append(i < 2 ? ' ' : '\n');
+        }
+      }
+
+      const char* data() const { return chars_.data(); }
+      size_t size() const { return size_; }
+
+      // staging storage for meshes which don't provide views onto their elements
+      std::pmr::vector<vec3f> vertices;
+      std::pmr::vector<face> faces;
+
+    private:
+      static constexpr size_t max_float_chars = 16;
+      static constexpr size_t max_index_chars = std::numeric_limits<vertex_index>::digits10 + 1;
+
+      void reserve(const size_t n)
+      {
+        if (chars_.size() < size_ + n)
+          chars_.resize(std::max(chars_.size() * 2, size_ + n));
+      }
+
+      void append(const std::string_view s)
+      {
+        std::ranges::copy(s, chars_.begin() + static_cast<std::ptrdiff_t>(size_));
+        size_ += s.size();
+      }
+
+      void append(const char c) { chars_[size_++] = c; }
+
+      template<typename T>
+      void append_number(const T value)
+      {
+        const auto result = std::to_chars(chars_.data() + size_, chars_.data() + chars_.size(), value);
+        size_ = static_cast<size_t>(result.ptr - chars_.data());
+      }
+
+      std::pmr::vector<char> chars_;
+      size_t size_ = 0;
+    };
+  }  // namespace
+
+  std::unique_ptr<tri_mesh> read_from_file(const std::filesystem::path& path, const size_t num_threads,
+                                           std::pmr::memory_resource* const resource)
+  {
+    const detail::mapped_file file{path};
+    const std::string_view text{reinterpret_cast<const char*>(file.data().data()), file.data().size()};
+
+    std::vector<obj_chunk> chunks;
+    std::ranges::transform(split_at_line_breaks(text, detail::resolve_num_threads(num_threads)),
+                           std::back_inserter(chunks), [](const auto chunk_text) { return obj_chunk{chunk_text}; });
+
+    // counting pass: determines the number of elements defined in each chunk so that the storage can be allocated
+    // up front and each chunk knows where to put its elements in the parsing pass
+    detail::parallel_invoke_n(chunks.size(), [&](const size_t i) { count_statements(chunks[i]); });
+
+    size_t num_vertices = 0;
+    size_t num_faces = 0;
+
+    for (auto& chunk : chunks)
+    {
+      chunk.first_vertex = std::exchange(num_vertices, num_vertices + chunk.num_vertices);
+      chunk.first_face = std::exchange(num_faces, num_faces + chunk.num_triangles);
+    }
+
+    // every vertex and face has to be addressable by the configured index types
+    detail::checked_index<vertex_index>(num_vertices);
+    detail::checked_index<face_index>(num_faces);
+
+    std::pmr::vector<vec3f> vertices(num_vertices, resource);
+    std::pmr::vector<face> faces(num_faces, resource);
+
+    detail::parallel_invoke_n(chunks.size(),
+                              [&](const size_t i) { parse_statements(chunks[i], num_vertices, vertices, faces); });
+
+    auto mesh = std::make_unique<detail::tri_mesh_impl>(std::move(vertices), std::move(faces), resource);
+    mesh->update_adjacency();
+    return mesh;
+  }
+
+  void write_to_file(const tri_mesh& mesh, const std::filesystem::path& path, const size_t num_threads,
+                     std::pmr::memory_resource* const resource)
+  {
+    std::ofstream ofs;
+    ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+    ofs.open(path, std::ios_base::binary);
+
+    const auto num_formatters = detail::resolve_num_threads(num_threads);
+    std::pmr::vector<format_buffer> buffers(num_formatters, resource);
+
+    // the blocks of a round are formatted in parallel, each into its own buffer, and written in order afterwards
+    const auto write_blocks = [&](const size_t num_elements, const auto& format_block) {
+      for (size_t first = 0; first < num_elements; first += num_formatters * elements_per_block)
+      {
+        detail::parallel_invoke_n(num_formatters, [&](const size_t i) {
+          const auto block_first = std::min(first + i * elements_per_block, num_elements);
+          const auto block_last = std::min(block_first + elements_per_block, num_elements);
+          format_block(buffers[i], block_first, block_last);
+        });
+
+        for (const auto& buffer : buffers)
+          ofs.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+      }
+    };
+
+    const auto vertices_view = mesh.vertices();
+    write_blocks(mesh.get_num_vertices(), [&](format_buffer& buffer, const size_t first, const size_t last) {
+      buffer.clear();
+
+      if (vertices_view)
+      {
+        for (const auto& v : vertices_view->subspan(first, last - first))
+          buffer.append_vertex(v);
+      } else
+      {
+        buffer.vertices.resize(last - first);
+        mesh.get_vertices(detail::narrow_index<vertex_index>(first), buffer.vertices);
+
+        for (const auto& v : buffer.vertices)
+          buffer.append_vertex(v);
+      }
+    });
+
+    const auto faces_view = mesh.faces();
+    write_blocks(mesh.get_num_faces(), [&](format_buffer& buffer, const size_t first, const size_t last) {
+      buffer.clear();
+
+      if (faces_view)
+      {
+        for (const auto& f : faces_view->subspan(first, last - first))
+          buffer.append_face(f);
+      } else
+      {
+        buffer.faces.resize(last - first);
+        mesh.get_faces(detail::narrow_index<face_index>(first), buffer.faces);
+
+        for (const auto& f : buffer.faces)
+          buffer.append_face(f);
+      }
+    });
+  }
+}  // namespace quxflux
@@ -0,0 +1,159 @@
+#include "tri_mesh.h"
+
+#include "tri_mesh_impl.h"
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace quxflux
+{
+  namespace
+  {
+    constexpr size_t not_visited = std::numeric_limits<size_t>::max();
+
+    // breadth first search from root which records the level of each reached vertex. Returns the vertices in the
+    // order they were reached, the vertices of the last level come last.
+    std::vector<vertex_index> bfs(const adjacency_view adjacency, const vertex_index root, std::vector<size_t>& level)
+    {
+      std::vector<vertex_index> reached{root};
+      level[root] = 0;
+
+      for (size_t head = 0; head < reached.size(); ++head)
+      {
+        const auto vi = reached[head];
+
+        for (const auto neighbor : adjacency[vi])
+        {
+          if (level[neighbor] != not_visited)
+            continue;
+
+          level[neighbor] = level[vi] + 1;
+          reached.push_back(neighbor);
+        }
+      }
+
+      return reached;
+    }
+
+    // finds a vertex of (approximately) maximum eccentricity in the component of start, which makes the level
+    // structures of the Cuthill-McKee ordering narrow (George and Liu)
+    vertex_index pseudo_peripheral_vertex(const adjacency_view adjacency, vertex_index start,
+                                          std::vector<size_t>& level)
+    {
+      size_t eccentricity = 0;
+
+      while (true)
+      {
+        const auto reached = bfs(adjacency, start, level);
+        const auto depth = level[reached.back()];
+
+        // the candidate with the lowest valence in the last level
+        auto candidate = reached.back();
+        for (auto it = reached.rbegin(); it != reached.rend() && level[*it] == depth; ++it)
+          if (adjacency[*it].size() < adjacency[candidate].size())
+            candidate = *it;
+
+        for (const auto vi : reached)
+          level[vi] = not_visited;
+
+        if (depth <= eccentricity)
+          return start;
+
+        eccentricity = depth;
+        start = candidate;
+      }
+    }
+
+    // reverse Cuthill-McKee ordering: breadth first traversal visiting the neighbors of each vertex in order of
+    // increasing valence, reversed at the end. Components are ordered one after another, each starting at a
+    // pseudo-peripheral vertex. Returns the old index of each new vertex.
+    std::vector<vertex_index> reverse_cuthill_mckee(const adjacency_view adjacency, const size_t n)
+    {
+      const auto valence = [&](const vertex_index vi) { return adjacency[vi].size(); };
+
+      // candidates for the start vertices of the components
+      std::vector<vertex_index> by_valence(n);
+      for (vertex_index vi = 0; vi < n; ++vi)
+        by_valence[vi] = vi;
+      std::ranges::stable_sort(by_valence, {}, valence);
+
+      std::vector<size_t> level(n, not_visited);
+      std::vector<bool> ordered(n, false);
+      std::vector<vertex_index> order;
+      order.reserve(n);
+      std::vector<vertex_index> unordered_neighbors;
+
+      for (const auto candidate : by_valence)
+      {
+        if (ordered[candidate])
+          continue;
+
+        const auto root = pseudo_peripheral_vertex(adjacency, candidate, level);
+        ordered[root] = true;
+        order.push_back(root);
+
+        for (size_t head = order.size() - 1; head < order.size(); ++head)
+        {
+          unordered_neighbors.clear();
+          for (const auto neighbor : adjacency[order[head]])
+          {
+            if (ordered[neighbor])
+              continue;
+
+            ordered[neighbor] = true;
+            unordered_neighbors.push_back(neighbor);
+          }
+
+          std::ranges::stable_sort(unordered_neighbors, {}, valence);
+          order.insert(order.end(), unordered_neighbors.begin(), unordered_neighbors.end());
+        }
+      }
+
+      std::ranges::reverse(order);
+      return order;
+    }
+  }  // namespace
+
+  std::vector<vertex_index> reorder_vertices(tri_mesh& mesh)
+  {
+    const auto n = mesh.get_num_vertices();
+
+    std::optional<detail::adjacency_storage> copied_adjacency;
+    auto adjacency = mesh.adjacency();
+    if (!adjacency)
+      adjacency = copied_adjacency.emplace(mesh).view();
+
+    auto new_to_old = reverse_cuthill_mckee(*adjacency, n);
+
+    std::vector<vertex_index> old_to_new(n);
+    for (vertex_index new_index = 0; new_index < n; ++new_index)
+      old_to_new[new_to_old[new_index]] = new_index;
+
+    {
+      std::vector<vec3f> old_vertices(n);
+      mesh.get_vertices(0, old_vertices);
+
+      std::vector<vec3f> new_vertices(n);
+      for (vertex_index new_index = 0; new_index < n; ++new_index)
+        new_vertices[new_index] = old_vertices[new_to_old[new_index]];
+
+      mesh.set_vertices(0, new_vertices);
+    }
+
+    // the order of the faces is kept on purpose: the neighbors of each vertex are then enumerated in the same order
+    // as before, so smoothing the reordered mesh yields exactly the same (permuted) positions
+    std::vector<face> faces(mesh.get_num_faces());
+    mesh.get_faces(0, faces);
+
+    for (face_index fi = 0; fi < faces.size(); ++fi)
+    {
+      std::ranges::transform(faces[fi], faces[fi].begin(), [&](const vertex_index vi) { return old_to_new[vi]; });
+      mesh.set_face(fi, faces[fi].data());
+    }
+
+    return new_to_old;
+  }
+}  // namespace quxflux
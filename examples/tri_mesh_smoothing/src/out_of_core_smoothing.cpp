@@ -0,0 +1,205 @@
+#include "out_of_core_smoothing.h"
+
+#include "binary_mesh_format.h"
+#include "blocked_smoothing.h"
+#include "mapped_file.h"
+#include "tri_mesh.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+namespace quxflux
+{
+  namespace
+  {
+    // bump allocates from a buffer of fixed size and throws std::bad_alloc once it is exhausted. The buffer is only
+    // backed by physical memory as far as it has been used.
+    class bounded_arena final : public std::pmr::memory_resource
+    {
+    public:
+      explicit bounded_arena(const size_t capacity)
+        : buffer_(std::make_unique_for_overwrite<std::byte[]>(capacity)), capacity_(capacity)
+      {}
+
+      // all memory allocated from the arena must have been deallocated before
+      void release() { used_ = 0; }
+      size_t used() const { return used_; }
+
+    private:
+      void* do_allocate(const size_t n_bytes, const size_t alignment) final
+      {
+        void* ptr = buffer_.get() + used_;
+        auto space = capacity_ - used_;
+
+        if (std::align(alignment, n_bytes, ptr, space) == nullptr)
+          throw std::bad_alloc{};
+
+        used_ = capacity_ - space + n_bytes;
+        return ptr;
+      }
+
+      void do_deallocate(void*, size_t, size_t) final {}
+
+      bool do_is_equal(const memory_resource& that) const noexcept final { return this == &that; }
+
+      std::unique_ptr<std::byte[]> buffer_;
+      size_t capacity_;
+      size_t used_ = 0;
+    };
+
+    // a file which holds the positions of all vertices contiguously, starting at offset
+    struct positions_file
+    {
+      std::filesystem::path path;
+      std::uint64_t offset = 0;
+    };
+
+    void accumulate(out_of_core_statistics& total, const out_of_core_statistics& pass)
+    {
+      total.num_passes += pass.num_passes;
+      total.num_chunks += pass.num_chunks;
+      total.num_vertex_updates += pass.num_vertex_updates;
+      total.num_halo_vertices += pass.num_halo_vertices;
+      total.num_bytes_read += pass.num_bytes_read;
+      total.num_bytes_written += pass.num_bytes_written;
+      total.peak_buffer_bytes = std::max(total.peak_buffer_bytes, pass.peak_buffer_bytes);
+    }
+  }  // namespace
+
+  out_of_core_statistics laplacian_smoothing_out_of_core(const std::filesystem::path& input_path,
+                                                         const std::filesystem::path& output_path,
+                                                         const size_t iterations, const out_of_core_options& options)
+  {
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+
+    // the faces and the adjacency don't change, the output is a copy of the input whose vertex block is overwritten
+    std::filesystem::copy_file(input_path, output_path, std::filesystem::copy_options::overwrite_existing);
+
+    const detail::mapped_file input{input_path};
+    // every pass reads the whole file anyway, one more for checking the indices doesn't matter
+    const auto header = detail::read_binary_mesh_header(input.data(), input_path, binary_mesh_validation::indices);
+    const auto n = static_cast<size_t>(header.num_vertices);
+    const adjacency_view adjacency{
+      detail::binary_mesh_block<const size_t>(input.data(), header.adjacency_offsets_offset, n + 1),
+      detail::binary_mesh_block<const vertex_index>(input.data(), header.adjacency_neighbors_offset,
+                                                    header.num_neighbors)};
+
+    const auto depth = std::max<size_t>(options.iterations_per_pass, 1);
+    const auto num_passes = (iterations + depth - 1) / depth;
+
+    // the passes alternate between writing to the output and the temporary file, so that the last one writes to the
+    // output
+    auto temporary_path = output_path;
+    temporary_path += ".positions";
+    const std::array<positions_file, 2> targets{positions_file{output_path, header.vertices_offset},
+                                                positions_file{temporary_path, 0}};
+    const auto target_of = [&](const size_t pass) -> const positions_file& {
+      return targets[(num_passes - 1 - pass) % 2];
+    };
+
+    if (num_passes > 1)
+    {
+      std::ofstream ofs;
+      ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+      ofs.open(temporary_path, std::ios_base::binary);
+
+      if (n > 0)
+      {
+        ofs.seekp(static_cast<std::streamoff>(n * sizeof(vec3f) - 1));
+        ofs.put('\0');
+      }
+    }
+
+    bounded_arena arena{options.memory_limit};
+    // first guess which assumes about 256 bytes per vertex of a chunk including its share of the halo, the following
+    // chunks are sized according to the memory required by the previous one
+    auto chunk_size = std::max<size_t>(options.memory_limit / 256, 1);
+    out_of_core_statistics total;
+
+    for (size_t pass = 0; pass < num_passes; ++pass)
+    {
+      const auto pass_start = clock::now();
+      const auto pass_iterations = std::min(depth, iterations - pass * depth);
+      out_of_core_statistics stats{.num_passes = 1};
+
+      std::optional<detail::mapped_file> source_file;
+      auto source = detail::binary_mesh_block<const vec3f>(input.data(), header.vertices_offset, n);
+      if (pass > 0)
+      {
+        const auto& previous = target_of(pass - 1);
+        source = detail::binary_mesh_block<const vec3f>(source_file.emplace(previous.path).data(), previous.offset, n);
+      }
+
+      const auto& target = target_of(pass);
+      std::fstream target_stream;
+      target_stream.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+      target_stream.open(target.path, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+
+      for (size_t first = 0; first < n;)
+      {
+        const auto last = first + std::min(chunk_size, n - first);
+        arena.release();
+
+        try
+        {
+          const auto tile = detail::make_range_tile(adjacency, first, last, pass_iterations, &arena);
+          detail::tile_buffers buffers{&arena};
+          const auto positions = detail::advance_tile(tile, pass_iterations, source, buffers);
+
+          target_stream.seekp(static_cast<std::streamoff>(target.offset + first * sizeof(vec3f)));
+          target_stream.write(reinterpret_cast<const char*>(positions.data()),
+                              static_cast<std::streamsize>(positions.size_bytes()));
+
+          ++stats.num_chunks;
+          stats.num_vertex_updates += positions.size() * pass_iterations;
+          stats.num_halo_vertices += tile.vertices.size() - positions.size();
+          stats.num_bytes_read += tile.vertices.size() * sizeof(vec3f) + tile.offsets.size() * sizeof(size_t) +
+                                  tile.neighbors.size() * sizeof(vertex_index);
+          stats.num_bytes_written += positions.size_bytes();
+        }
+        catch (const std::bad_alloc&)
+        {
+          if (last - first == 1)
+            throw std::runtime_error("the memory limit of " + std::to_string(options.memory_limit) +
+                                     " bytes is too small to smooth a single vertex together with its halo");
+
+          chunk_size = (last - first) / 2;
+          continue;
+        }
+
+        stats.peak_buffer_bytes = std::max(stats.peak_buffer_bytes, arena.used());
+
+        // size the next chunk to fill about three quarters of the limit, assuming that its halo is of similar size
+        const auto bytes_per_vertex = static_cast<double>(arena.used()) / static_cast<double>(last - first);
+        chunk_size = std::max<size_t>(
+          static_cast<size_t>(0.75 * static_cast<double>(options.memory_limit) / bytes_per_vertex), 1);
+        first = last;
+      }
+
+      target_stream.close();
+      source_file.reset();
+
+      stats.duration = clock::now() - pass_start;
+      accumulate(total, stats);
+
+      if (options.on_pass)
+        options.on_pass(stats);
+    }
+
+    if (num_passes > 1)
+      std::filesystem::remove(temporary_path);
+
+    total.duration = clock::now() - start;
+    return total;
+  }
+}  // namespace quxflux
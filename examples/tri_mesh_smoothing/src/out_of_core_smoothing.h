@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+
+namespace quxflux
+{
+  struct out_of_core_statistics
+  {
+    // every pass reads all positions once and advances them by up to iterations_per_pass iterations
+    size_t num_passes = 0;
+    size_t num_chunks = 0;
+    // number of vertices times the number of iterations they were advanced by, excluding the halos
+    size_t num_vertex_updates = 0;
+    // number of vertices loaded as halos in addition to the vertices of the chunks
+    size_t num_halo_vertices = 0;
+    // positions and adjacency gathered from the files respectively positions written to them
+    size_t num_bytes_read = 0;
+    size_t num_bytes_written = 0;
+    // highest number of bytes used by the buffers of a single chunk, at most memory_limit
+    size_t peak_buffer_bytes = 0;
+    std::chrono::nanoseconds duration{};
+  };
+
+  struct out_of_core_options
+  {
+    // upper bound of the memory used for the buffers of a chunk in bytes. The number of vertices per chunk is adapted
+    // so that each chunk including its halo fits. The pages of the memory mapped files are not included, they are
+    // read only and evicted by the operating system as needed.
+    size_t memory_limit = size_t{256} << 20;
+    // number of iterations each chunk is advanced by per pass, which is the depth of its halo. Deeper halos need
+    // fewer passes over the files but more memory and redundant work per chunk.
+    size_t iterations_per_pass = 4;
+    // invoked after each pass with the statistics of the pass
+    std::function<void(const out_of_core_statistics&)> on_pass;
+  };
+
+  // performs iterations iterations of Laplacian smoothing on the binary mesh at input_path (see write_binary) and
+  // writes the result to output_path without loading the whole mesh into memory. The vertices are processed in chunks
+  // of consecutive indices which are surrounded by halo vertices, the result is bit-identical to the one of
+  // laplacian_smoothing. The chunks are only spatially compact if the vertex order is, e.g. after reorder_vertices,
+  // otherwise the halos grow and the chunks shrink. Between the passes the positions are kept in the temporary file
+  // output_path + ".positions". Throws if a single vertex and its halo exceed the memory limit.
+  out_of_core_statistics laplacian_smoothing_out_of_core(const std::filesystem::path& input_path,
+                                                         const std::filesystem::path& output_path, size_t iterations,
+                                                         const out_of_core_options& options = {});
+}  // namespace quxflux
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace quxflux::detail
+{
+  // resolves a requested number of threads, 0 selects std::thread::hardware_concurrency()
+  inline size_t resolve_num_threads(const size_t requested)
+  {
+    return std::max<size_t>(requested == 0 ? std::thread::hardware_concurrency() : requested, 1);
+  }
+
+  // invokes task(i) for every i in [0, n), each invocation on its own thread (i = 0 on the calling thread). Once
+  // all tasks finished, the exception thrown by the task with the lowest index (if any) is rethrown.
+  template<typename Task>
+  void parallel_invoke_n(const size_t n, Task task)
+  {
+    std::vector<std::exception_ptr> exceptions(n);
+
+    const auto run = [&](const size_t i) {
+      try
+      {
+        task(i);
+      }
+      catch (...)
+      {
+        exceptions[i] = std::current_exception();
+      }
+    };
+
+    {
+      std::vector<std::jthread> threads;
+      threads.reserve(n > 0 ? n - 1 : 0);
+
+      for (size_t i = 1; i < n; ++i)
+        threads.emplace_back(run, i);
+
+      if (n > 0)
+        run(0);
+    }
+
+    for (const auto& e : exceptions)
+      if (e)
+        std::rethrow_exception(e);
+  }
+}  // namespace quxflux::detail
@@ -0,0 +1,299 @@
+#include "soa_smoothing.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <ranges>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define QUXFLUX_X86_SIMD
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define QUXFLUX_TARGET_AVX2
+#else
+#define QUXFLUX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace quxflux::detail
+{
+  namespace
+  {
+    // scalar fallback, also processes the remainder of the vertex ranges which doesn't fill a whole lane group
+    void smooth_scalar(const adjacency_view& adjacency, const soa_span<const float> org,
+                       const soa_span<float> smoothed, const vertex_index first, const vertex_index last)
+    {
+      for (vertex_index vi = first; vi < last; ++vi)
+      {
+        const auto neighbors = adjacency[vi];
+
+        if (neighbors.empty()) [[unlikely]]
+        {
+          smoothed.x[vi] = org.x[vi];
+          smoothed.y[vi] = org.y[vi];
+          smoothed.z[vi] = org.z[vi];
+          continue;
+        }
+
+        float x = 0.f, y = 0.f, z = 0.f;
+
+        for (const auto ni : neighbors)
+        {
+          x += org.x[ni];
+          y += org.y[ni];
+          z += org.z[ni];
+        }
+
+        const auto n_recip = 1.f / static_cast<float>(neighbors.size());
+        smoothed.x[vi] = x * n_recip;
+        smoothed.y[vi] = y * n_recip;
+        smoothed.z[vi] = z * n_recip;
+      }
+    }
+
+#ifdef QUXFLUX_X86_SIMD
+    bool cpu_supports_avx2()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+      std::array<int, 4> info{};
+      __cpuid(info.data(), 0);
+      if (info[0] < 7)
+        return false;
+
+      __cpuid(info.data(), 1);
+      const bool os_saves_ymm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+      const bool has_avx = (info[2] & (1 << 28)) != 0;
+
+      __cpuidex(info.data(), 7, 0);
+      const bool has_avx2 = (info[1] & (1 << 5)) != 0;
+
+      return os_saves_ymm && has_avx && has_avx2;
+#else
+      return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    // the simd implementations process one vertex per lane. Each lane accumulates the neighbors of its vertex in
+    // the same order as the scalar implementation does and lanes without further neighbors add 0, so the results
+    // are bit-identical to the scalar ones.
+    // processes the slices of the lane adjacency which are entirely contained in [first, last), the remaining
+    // vertices at both ends are processed by the scalar implementation
+    template<typename SmoothSlice>
+    void smooth_slices(const adjacency_view& adjacency, const lane_adjacency& lanes, const soa_span<const float> org,
+                       const soa_span<float> smoothed, const vertex_index first, const vertex_index last,
+                       SmoothSlice smooth_slice)
+    {
+      const auto l = lanes.num_lanes;
+      const size_t first_slice = (first + l - 1) / l;
+      const size_t last_slice = std::max<size_t>(last / l, first_slice);
+
+      smooth_scalar(adjacency, org, smoothed, first,
+                    narrow_index<vertex_index>(std::min<size_t>(first_slice * l, last)));
+
+      for (auto slice = first_slice; slice < last_slice; ++slice)
+        smooth_slice(slice);
+
+      smooth_scalar(adjacency, org, smoothed, narrow_index<vertex_index>(std::max<size_t>(last_slice * l, first)),
+                    last);
+    }
+
+    void smooth_sse(const adjacency_view& adjacency, const lane_adjacency& lanes, const soa_span<const float> org,
+                    const soa_span<float> smoothed, const vertex_index first, const vertex_index last)
+    {
+      smooth_slices(adjacency, lanes, org, smoothed, first, last, [&](const size_t slice) {
+        const auto vi = slice * 4;
+        const auto valences = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes.valences.data() + vi));
+        const auto slice_indices = std::span{lanes.indices}.subspan(
+          lanes.slice_offsets[slice], lanes.slice_offsets[slice + 1] - lanes.slice_offsets[slice]);
+
+        auto x = _mm_setzero_ps(), y = _mm_setzero_ps(), z = _mm_setzero_ps();
+
+        for (size_t k = 0; k * 4 < slice_indices.size(); ++k)
+        {
+          const auto mask = _mm_castsi128_ps(_mm_cmpgt_epi32(valences, _mm_set1_epi32(static_cast<std::int32_t>(k))));
+          const auto idx = slice_indices.subspan(k * 4, 4);
+
+          const auto load = [&](const std::span<const float> c) {
+            return _mm_and_ps(mask, _mm_set_ps(c[static_cast<size_t>(idx[3])], c[static_cast<size_t>(idx[2])],
+                                               c[static_cast<size_t>(idx[1])], c[static_cast<size_t>(idx[0])]));
+          };
+
+          x = _mm_add_ps(x, load(org.x));
+          y = _mm_add_ps(y, load(org.y));
+          z = _mm_add_ps(z, load(org.z));
+        }
+
+        const auto isolated = _mm_castsi128_ps(_mm_cmpeq_epi32(valences, _mm_setzero_si128()));
+        const auto n_recip = _mm_div_ps(_mm_set1_ps(1.f), _mm_cvtepi32_ps(valences));
+
+        const auto store = [&](const __m128 sum, const std::span<const float> org_c, const std::span<float> dst) {
+          const auto averaged = _mm_mul_ps(sum, n_recip);
+          const auto result =
+            _mm_or_ps(_mm_and_ps(isolated, _mm_loadu_ps(org_c.data() + vi)), _mm_andnot_ps(isolated, averaged));
+          _mm_storeu_ps(dst.data() + vi, result);
+        };
+
+        store(x, org.x, smoothed.x);
+        store(y, org.y, smoothed.y);
+        store(z, org.z, smoothed.z);
+      });
+    }
+
+    // lambdas don't inherit the target attribute, so the avx2 slice kernel is a separate function
+    QUXFLUX_TARGET_AVX2 void smooth_avx2_slice(const lane_adjacency& lanes, const soa_span<const float> org,
+                                               const soa_span<float> smoothed, const size_t slice)
+    {
+      const auto vi = slice * 8;
+      const auto valences = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes.valences.data() + vi));
+      const auto* const slice_indices = lanes.indices.data() + lanes.slice_offsets[slice];
+      const auto num_slice_indices = lanes.slice_offsets[slice + 1] - lanes.slice_offsets[slice];
+
+      auto x = _mm256_setzero_ps(), y = _mm256_setzero_ps(), z = _mm256_setzero_ps();
+
+      for (size_t k = 0; k * 8 < num_slice_indices; ++k)
+      {
+        const auto mask =
+          _mm256_castsi256_ps(_mm256_cmpgt_epi32(valences, _mm256_set1_epi32(static_cast<std::int32_t>(k))));
+        const auto idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(slice_indices + k * 8));
+
+        x = _mm256_add_ps(x, _mm256_mask_i32gather_ps(_mm256_setzero_ps(), org.x.data(), idx, mask, 4));
+        y = _mm256_add_ps(y, _mm256_mask_i32gather_ps(_mm256_setzero_ps(), org.y.data(), idx, mask, 4));
+        z = _mm256_add_ps(z, _mm256_mask_i32gather_ps(_mm256_setzero_ps(), org.z.data(), idx, mask, 4));
+      }
+
+      const auto isolated = _mm256_castsi256_ps(_mm256_cmpeq_epi32(valences, _mm256_setzero_si256()));
+      const auto n_recip = _mm256_div_ps(_mm256_set1_ps(1.f), _mm256_cvtepi32_ps(valences));
+
+      _mm256_storeu_ps(smoothed.x.data() + vi,
+                       _mm256_blendv_ps(_mm256_mul_ps(x, n_recip), _mm256_loadu_ps(org.x.data() + vi), isolated));
+      _mm256_storeu_ps(smoothed.y.data() + vi,
+                       _mm256_blendv_ps(_mm256_mul_ps(y, n_recip), _mm256_loadu_ps(org.y.data() + vi), isolated));
+      _mm256_storeu_ps(smoothed.z.data() + vi,
+                       _mm256_blendv_ps(_mm256_mul_ps(z, n_recip), _mm256_loadu_ps(org.z.data() + vi), isolated));
+    }
+
+    void smooth_avx2(const adjacency_view& adjacency, const lane_adjacency& lanes, const soa_span<const float> org,
+                     const soa_span<float> smoothed, const vertex_index first, const vertex_index last)
+    {
+      smooth_slices(adjacency, lanes, org, smoothed, first, last,
+                    [&](const size_t slice) { smooth_avx2_slice(lanes, org, smoothed, slice); });
+    }
+#endif
+  }  // namespace
+
+  void soa_vertices::assign(const std::span<const vec3f> vertices)
+  {
+    x.resize(vertices.size());
+    y.resize(vertices.size());
+    z.resize(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+      x[i] = vertices[i][0];
+      y[i] = vertices[i][1];
+      z[i] = vertices[i][2];
+    }
+  }
+
+  void soa_vertices::copy_to(const std::span<vec3f> vertices) const
+  {
+    for (size_t i = 0; i < vertices.size(); ++i)
+      vertices[i] = {x[i], y[i], z[i]};
+  }
+
+  lane_adjacency make_lane_adjacency(const simd_instruction_set instruction_set, const adjacency_view& adjacency)
+  {
+    lane_adjacency lanes;
+
+    switch (instruction_set)
+    {
+      case simd_instruction_set::avx2:
+        lanes.num_lanes = 8;
+        break;
+      case simd_instruction_set::sse:
+        lanes.num_lanes = 4;
+        break;
+      default:
+        // the scalar implementation uses the adjacency directly
+        return lanes;
+    }
+
+    const auto num_vertices = adjacency.offsets.size() - 1;
+    const auto num_slices = num_vertices / lanes.num_lanes;
+
+    lanes.valences.resize(num_slices * lanes.num_lanes);
+    lanes.slice_offsets.resize(num_slices + 1, 0);
+
+    for (size_t slice = 0; slice < num_slices; ++slice)
+    {
+      const auto slice_vertices = std::views::iota(slice * lanes.num_lanes, (slice + 1) * lanes.num_lanes);
+
+      size_t max_valence = 0;
+      for (const auto vi : slice_vertices)
+      {
+        lanes.valences[vi] = static_cast<std::int32_t>(adjacency[vi].size());
+        max_valence = std::max(max_valence, adjacency[vi].size());
+      }
+
+      lanes.slice_offsets[slice + 1] = lanes.slice_offsets[slice] + max_valence * lanes.num_lanes;
+    }
+
+    lanes.indices.resize(lanes.slice_offsets.back(), 0);
+
+    for (size_t slice = 0; slice < num_slices; ++slice)
+    {
+      for (size_t lane = 0; lane < lanes.num_lanes; ++lane)
+      {
+        const auto neighbors = adjacency[slice * lanes.num_lanes + lane];
+
+        for (size_t k = 0; k < neighbors.size(); ++k)
+          lanes.indices[lanes.slice_offsets[slice] + k * lanes.num_lanes + lane] =
+            static_cast<std::int32_t>(neighbors[k]);
+      }
+    }
+
+    return lanes;
+  }
+
+  simd_instruction_set resolve_instruction_set(const simd_instruction_set requested, const size_t num_vertices)
+  {
+#ifdef QUXFLUX_X86_SIMD
+    // the lanes address the vertices using 32 bit signed indices
+    const bool indices_fit_lanes = num_vertices <= static_cast<size_t>(std::numeric_limits<std::int32_t>::max());
+
+    if (!indices_fit_lanes || requested == simd_instruction_set::scalar)
+      return simd_instruction_set::scalar;
+
+    if (requested != simd_instruction_set::sse && cpu_supports_avx2())
+      return simd_instruction_set::avx2;
+
+    return simd_instruction_set::sse;
+#else
+    static_cast<void>(requested);
+    static_cast<void>(num_vertices);
+    return simd_instruction_set::scalar;
+#endif
+  }
+
+  void smooth_soa(const simd_instruction_set instruction_set, const adjacency_view& adjacency,
+                  const lane_adjacency& lane_adjacency, const soa_span<const float> org_vertices,
+                  const soa_span<float> smoothed_vertices, const vertex_index first, const vertex_index last)
+  {
+    switch (instruction_set)
+    {
+#ifdef QUXFLUX_X86_SIMD
+      case simd_instruction_set::avx2:
+        smooth_avx2(adjacency, lane_adjacency, org_vertices, smoothed_vertices, first, last);
+        break;
+      case simd_instruction_set::sse:
+        smooth_sse(adjacency, lane_adjacency, org_vertices, smoothed_vertices, first, last);
+        break;
+#endif
+      default:
+        smooth_scalar(adjacency, org_vertices, smoothed_vertices, first, last);
+        break;
+    }
+  }
+}  // namespace quxflux::detail
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "laplacian_smoothing.h"
+#include "tri_mesh.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace quxflux::detail
+{
+  // vertex positions in structure-of-arrays layout
+  template<typename T>
+  struct soa_span
+  {
+    std::span<T> x;
+    std::span<T> y;
+    std::span<T> z;
+  };
+
+  struct soa_vertices
+  {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+
+    void assign(std::span<const vec3f> vertices);
+    void copy_to(std::span<vec3f> vertices) const;
+
+    soa_span<const float> view() const { return {x, y, z}; }
+    soa_span<float> view() { return {x, y, z}; }
+  };
+
+  // neighbor indices in sliced ELLPACK layout for the simd kernels: the vertices are grouped into slices of
+  // num_lanes consecutive vertices and for each slice the k-th neighbors of all lanes are stored contiguously.
+  // Lanes with less than k neighbors are padded with index 0, the loaded values are masked out using the valences.
+  struct lane_adjacency
+  {
+    size_t num_lanes = 1;
+    std::vector<size_t> slice_offsets;
+    std::vector<std::int32_t> valences;
+    std::vector<std::int32_t> indices;
+  };
+
+  // returns the widest instruction set supported by the executing cpu which is not wider than requested
+  simd_instruction_set resolve_instruction_set(simd_instruction_set requested, size_t num_vertices);
+
+  lane_adjacency make_lane_adjacency(simd_instruction_set instruction_set, const adjacency_view& adjacency);
+
+  // calculates the smoothed positions of the vertices [first, last) from org_vertices; the results are
+  // bit-identical to the ones of the scalar array-of-structures implementation regardless of the instruction set
+  void smooth_soa(simd_instruction_set instruction_set, const adjacency_view& adjacency,
+                  const lane_adjacency& lane_adjacency, soa_span<const float> org_vertices,
+                  soa_span<float> smoothed_vertices, vertex_index first, vertex_index last);
+}  // namespace quxflux::detail
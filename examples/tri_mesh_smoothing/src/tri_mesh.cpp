@@ -1,89 +1,166 @@
 #include "tri_mesh.h"
 
+#include "parallel.h"
+#include "tri_mesh_impl.h"
+
 #include <algorithm>
 #include <array>
-#include <fstream>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
 #include <functional>
+#include <memory_resource>
 #include <numeric>
 #include <random>
 #include <ranges>
-#include <unordered_set>
-#include <unordered_map>
+#include <span>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace quxflux
 {
-  namespace
+  namespace detail
   {
-    struct tri_mesh_impl : tri_mesh
-    {
-      size_t get_num_vertices() const final { return vertices_.size(); }
+    lazy_adjacency::lazy_adjacency(const allocator_type& alloc) : offsets_(1, 0, alloc), neighbors_(alloc) {}
 
-      void get_vertex(const vertex_index i, float* const data) const final { std::ranges::copy(vertices_[i], data); }
+    lazy_adjacency::lazy_adjacency(const adjacency_view& adjacency, const allocator_type& alloc)
+      : offsets_(adjacency.offsets.begin(), adjacency.offsets.end(), alloc),
+        neighbors_(adjacency.neighbors.begin(), adjacency.neighbors.end(), alloc), dirty_(false)
+    {}
 
-      void set_vertex(const vertex_index i, const float* const data) final
+    lazy_adjacency::lazy_adjacency(const lazy_adjacency& other, const allocator_type& alloc)
+      : offsets_(alloc), neighbors_(alloc)
+    {
+      // make sure the adjacency of other is not rebuilt while being copied
+      std::scoped_lock lock{other.mutex_};
+
+      if (other.dirty_)
       {
-        std::ranges::copy_n(data, 3, vertices_[i].begin());
+        offsets_.assign(1, 0);
       }
+      else
+      {
+        offsets_ = other.offsets_;
+        neighbors_ = other.neighbors_;
+        dirty_ = false;
 
-      size_t get_vertex_valence(const vertex_index i) const final { return vertices_neighbors_[i].size(); }
+        if (!other.cache_)
+          other.cache_ = std::make_shared<adjacency_cache>();
+        cache_ = other.cache_;
+      }
+    }
 
-      size_t get_vertex_neighbors(const vertex_index i, vertex_index* const buf, const size_t buf_size) const final
+    adjacency_view lazy_adjacency::get(const size_t num_vertices, const std::span<const face> faces) const
+    {
+      if (dirty_.load(std::memory_order_acquire))
       {
-        const auto& neighbors = vertices_neighbors_[i];
-        const auto n = std::min(buf_size, neighbors.size());
-        std::ranges::copy_n(neighbors.begin(), n, buf);
+        std::scoped_lock lock{mutex_};
 
-        return n;
+        if (dirty_.load(std::memory_order_relaxed))
+        {
+          build(num_vertices, faces);
+          dirty_.store(false, std::memory_order_release);
+        }
       }
 
-      size_t get_num_faces() const final { return faces_.size(); }
+      return {offsets_, neighbors_};
+    }
 
-      void get_face(const face_index i, vertex_index* const data) const final { std::ranges::copy(faces_[i], data); }
+    adjacency_cache& lazy_adjacency::cache() const
+    {
+      std::scoped_lock lock{mutex_};
 
-      void set_face(const face_index i, const vertex_index* const data) final
-      {
-        std::ranges::copy_n(data, 3, faces_[i].begin());
-      }
+      if (!cache_)
+        cache_ = std::make_shared<adjacency_cache>();
 
-      std::unique_ptr<tri_mesh> clone() const final { return std::make_unique<tri_mesh_impl>(*this); }
+      return *cache_;
+    }
 
-      void add_vertex(const vec3f& v)
-      {
-        vertices_.push_back(v);
-        vertices_neighbors_.push_back({});
-      }
+    void lazy_adjacency::build(const size_t n, const std::span<const face> faces) const
+    {
+      // each face contributes at most two neighbors to each of its vertices; reserve this upper bound per vertex
+      // so that the candidates can be scattered in a single pass over the faces
+      std::vector<size_t> candidate_offsets(n + 1, 0);
+      for (const auto& f : faces)
+        for (const auto vi : f)
+          candidate_offsets[vi + 1] += 2;
 
-      void add_face(const std::array<vertex_index, 3>& face)
-      {
-        faces_.push_back(face);
+      std::partial_sum(candidate_offsets.begin(), candidate_offsets.end(), candidate_offsets.begin());
+
+      std::vector<vertex_index> candidates(candidate_offsets[n]);
+      std::vector<size_t> candidate_counts(n, 0);
 
+      for (const auto& f : faces)
+      {
         for (size_t i = 0; i < 3; ++i)
         {
-          const std::array neighbors{face[(i + 1) % 3], face[(i + 2) % 3]};
+          const auto vi = f[i];
+          auto* const this_vertex_candidates = candidates.data() + candidate_offsets[vi];
+          this_vertex_candidates[candidate_counts[vi]++] = f[(i + 1) % 3];
+          this_vertex_candidates[candidate_counts[vi]++] = f[(i + 2) % 3];
+        }
+      }
 
-          auto& this_vertex_neighbors = vertices_neighbors_[face[i]];
+      // compact the candidates, skipping duplicates while preserving the order of first occurrence (i.e. the
+      // order in which the neighbors are encountered when walking the faces). The neighbors are compacted in place
+      // and copied into exactly sized storage afterwards, so that no capacity is wasted in the storage of the mesh,
+      // which may well be a monotonic arena.
+      offsets_.assign(n + 1, 0);
+      size_t num_neighbors = 0;
 
-          const auto already_present = [&](const auto neighbor) {
-            return std::ranges::find(this_vertex_neighbors, neighbor) != this_vertex_neighbors.end();
-          };
+      for (size_t vi = 0; vi < n; ++vi)
+      {
+        const auto first_neighbor = candidates.begin() + static_cast<std::ptrdiff_t>(num_neighbors);
+        const auto this_vertex_candidates =
+          std::span{candidates}.subspan(candidate_offsets[vi], candidate_counts[vi]);
 
-          std::ranges::copy_if(neighbors, std::back_inserter(this_vertex_neighbors), std::not_fn(already_present));
+        for (const auto neighbor : this_vertex_candidates)
+        {
+          const auto last_neighbor = candidates.begin() + static_cast<std::ptrdiff_t>(num_neighbors);
+          if (std::find(first_neighbor, last_neighbor, neighbor) == last_neighbor)
+            candidates[num_neighbors++] = neighbor;
         }
+
+        offsets_[vi + 1] = num_neighbors;
       }
 
-    private:
-      std::vector<vec3f> vertices_;
-      std::vector<std::vector<vertex_index>> vertices_neighbors_;
-      std::vector<std::array<vertex_index, 3>> faces_;
-    };
+      neighbors_.assign(candidates.begin(), candidates.begin() + static_cast<std::ptrdiff_t>(num_neighbors));
+    }
 
-    template<typename T>
-    constexpr T pairing_func(const T x, const T y)
+    adjacency_storage::adjacency_storage(const tri_mesh& mesh) : offsets(mesh.get_num_vertices() + 1, 0)
     {
-      return ((x + y) * (x + y + 1)) / 2 + y;
+      for (vertex_index vi = 0; vi < mesh.get_num_vertices(); ++vi)
+        offsets[vi + 1] = offsets[vi] + mesh.get_vertex_valence(vi);
+
+      neighbors.resize(offsets.back());
+
+      for (vertex_index vi = 0; vi < mesh.get_num_vertices(); ++vi)
+        mesh.get_vertex_neighbors(vi, neighbors.data() + offsets[vi], offsets[vi + 1] - offsets[vi]);
     }
 
+    tri_mesh_impl::tri_mesh_impl(const allocator_type& alloc) : vertices_(alloc), faces_(alloc), adjacency_(alloc) {}
+
+    tri_mesh_impl::tri_mesh_impl(std::pmr::vector<vec3f> vertices, std::pmr::vector<face> faces,
+                                 const allocator_type& alloc)
+      : vertices_(std::move(vertices), alloc), faces_(std::move(faces), alloc), adjacency_(alloc)
+    {}
+
+    tri_mesh_impl::tri_mesh_impl(std::pmr::vector<vec3f> vertices, std::pmr::vector<face> faces,
+                                 const adjacency_view& adjacency, const allocator_type& alloc)
+      : vertices_(std::move(vertices), alloc), faces_(std::move(faces), alloc), adjacency_(adjacency, alloc)
+    {}
+
+    tri_mesh_impl::tri_mesh_impl(const tri_mesh_impl& other, const allocator_type& alloc)
+      : vertices_(other.vertices_, alloc), faces_(other.faces_, alloc), adjacency_(other.adjacency_, alloc)
+    {}
+  }  // namespace detail
+
+  namespace
+  {
+    using detail::tri_mesh_impl;
+
     vec3f normalized(const vec3f& v)
     {
       vec3f result = v;
@@ -97,97 +174,106 @@ namespace quxflux
 
     vec3f midpoint(const vec3f& a, const vec3f& b)
     {
-      vec3f r;
+      vec3f r{};
       std::ranges::transform(a, b, r.begin(), [](const auto t0, const auto t1) { return std::midpoint(t0, t1); });
       return r;
     }
-  }  // namespace
-
-  std::unique_ptr<tri_mesh> read_from_file(const std::filesystem::path& path)
-  {
-    auto mesh = std::make_unique<tri_mesh_impl>();
-
-    std::ifstream ifs;
-    ifs.open(path);
 
-    while (ifs.good())
+    // open addressing hash table (linear probing) which maps the edges of a mesh to the vertex inserted at their
+    // midpoint. Insertions are thread-safe as long as every edge is inserted at most once, lookups must not
+    // happen before all insertions finished.
+    class edge_midpoint_table
     {
-      char firstChar;
-
-      ifs >> firstChar;
+    public:
+      edge_midpoint_table(const size_t num_edges, std::pmr::memory_resource* const resource)
+        : keys_(std::bit_ceil(2 * std::max<size_t>(num_edges, 1)), resource),
+          midpoints_(keys_.size(), resource), mask_(keys_.size() - 1)
+      {}
 
-      firstChar = std::tolower(firstChar, std::locale());
-
-      switch (firstChar)
+      void insert(const vertex_index a, const vertex_index b, const vertex_index midpoint)
       {
-        case 'v': {
-          vec3f t;
-
-          ifs >> t[0];
-          ifs >> t[1];
-          ifs >> t[2];
+        const auto k = key(a, b);
 
-          mesh->add_vertex(t);
+        for (auto slot = first_slot(k);; slot = (slot + 1) & mask_)
+        {
+          uint64_t expected = empty_key;
+          if (keys_[slot].compare_exchange_strong(expected, k, std::memory_order_relaxed))
+          {
+            midpoints_[slot] = midpoint;
+            return;
+          }
         }
-        break;
-        case 'f': {
-          std::array<vertex_index, 3> face_indices;
+      }
 
-          ifs >> face_indices[0];
-          ifs >> face_indices[1];
-          ifs >> face_indices[2];
+      vertex_index find(const vertex_index a, const vertex_index b) const
+      {
+        const auto k = key(a, b);
 
-          // vertex indices in obj are 1-based
-          std::ranges::transform(face_indices, face_indices.begin(), [](const auto i) { return i - 1; });
+        auto slot = first_slot(k);
+        while (keys_[slot].load(std::memory_order_relaxed) != k)
+          slot = (slot + 1) & mask_;
 
-          mesh->add_face(face_indices);
-        }
-        break;
-        default:
-          break;
+        return midpoints_[slot];
       }
 
-      ifs.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    }
+    private:
+      // a valid edge connects two different vertices, so its key is never 0
+      static constexpr uint64_t empty_key = 0;
 
-    return mesh;
-  }
+      static uint64_t key(const vertex_index a, const vertex_index b)
+      {
+        return (uint64_t{std::min(a, b)} << 32) | uint64_t{std::max(a, b)};
+      }
 
-  void write_to_file(const tri_mesh& mesh, const std::filesystem::path& path)
-  {
-    std::ofstream ofs;
-    ofs.exceptions(std::ios_base::failbit);
-    ofs.open(path);
+      size_t first_slot(const uint64_t k) const { return (k * 0x9E3779B97F4A7C15ull >> 32) & mask_; }
 
-    for (auto v : mesh_vertices(mesh))
-      ofs << "v " << v[0] << ' ' << v[1] << ' ' << v[2] << '\n';
+      std::pmr::vector<std::atomic<uint64_t>> keys_;
+      std::pmr::vector<vertex_index> midpoints_;
+      size_t mask_;
+    };
 
-    for (auto f : mesh_faces(mesh))
+    // invokes task(first, last) for num_tasks consecutive slices of [0, n) in parallel
+    template<typename Task>
+    void parallel_for_slices(const size_t n, const size_t num_tasks, Task task)
     {
-      // vertex indices in obj are 1-based
-      std::ranges::transform(f, f.begin(), std::bind_front(std::plus<>{}, size_t{1}));
-      ofs << "f " << f[0] << ' ' << f[1] << ' ' << f[2] << '\n';
+      detail::parallel_invoke_n(num_tasks, [&](const size_t i) { task(n * i / num_tasks, n * (i + 1) / num_tasks); });
     }
-  }
+  }  // namespace
 
-  std::unique_ptr<tri_mesh> generate_noisy_unit_sphere(const size_t num_sudivisions, const float stddev)
+  std::vector<size_t> vertex_valence_histogram(const tri_mesh& mesh)
   {
-    using face = std::array<vertex_index, 3>;
+    std::vector<size_t> histogram;
+    const auto adjacency = mesh.adjacency();
 
-    struct face_hasher
+    for (size_t vi = 0; vi < mesh.get_num_vertices(); ++vi)
     {
-      constexpr auto operator()(const face& f) const noexcept { return pairing_func(pairing_func(f[0], f[1]), f[2]); }
-    };
+      const auto valence =
+        adjacency ? (*adjacency)[vi].size() : mesh.get_vertex_valence(detail::narrow_index<vertex_index>(vi));
+      if (valence >= histogram.size())
+        histogram.resize(valence + 1);
 
-    struct edge_hasher
-    {
-      constexpr auto operator()(const std::pair<vertex_index, vertex_index>& edge) const noexcept
-      {
-        return pairing_func(edge.first, edge.second);
-      }
-    };
+      ++histogram[valence];
+    }
 
-    using faces_container = std::unordered_set<face, face_hasher>;
+    return histogram;
+  }
+
+  std::unique_ptr<tri_mesh> generate_noisy_unit_sphere(const size_t subdivision_level, const float stddev,
+                                                       const size_t num_threads,
+                                                       std::pmr::memory_resource* const resource)
+  {
+    // the edge keys of edge_midpoint_table pack two vertex indices into 64 bits, level 14 is the highest level
+    // whose vertex count fits into 32 bits
+    static constexpr size_t max_subdivision_level = 14;
+    if (subdivision_level > max_subdivision_level)
+      throw std::invalid_argument("subdivision level " + std::to_string(subdivision_level) +
+                                  " exceeds the maximum of " + std::to_string(max_subdivision_level));
+
+    // don't spread tiny levels across threads
+    static constexpr size_t min_faces_per_task = 1 << 14;
+    const auto num_tasks = [max_tasks = detail::resolve_num_threads(num_threads)](const size_t n) {
+      return std::clamp<size_t>(n / min_faces_per_task, 1, max_tasks);
+    };
 
     // create the sphere by incrementally subdividing an octahedron and reprojecting the resulting vertices onto the
     // unit sphere
@@ -196,54 +282,114 @@ namespace quxflux
     static constexpr auto octahedron_faces = std::to_array<face>(
       {{0, 2, 1}, {0, 3, 2}, {0, 4, 3}, {0, 1, 4}, {5, 1, 2}, {5, 2, 3}, {5, 3, 4}, {5, 4, 1}});
 
-    std::vector<vec3f> vertices{octahedron_vertices.begin(), octahedron_vertices.end()};
-    faces_container faces{octahedron_faces.begin(), octahedron_faces.end()};
+    // the vertices are allocated for the final level right away, so that they are never reallocated in resource.
+    // The faces of the intermediate levels are temporaries, the last level writes its faces to result_faces.
+    std::pmr::vector<vec3f> vertices{resource};
+    vertices.reserve(4 * (size_t{1} << (2 * subdivision_level)) + 2);
+    vertices.assign(octahedron_vertices.begin(), octahedron_vertices.end());
 
-    std::unordered_map<std::pair<vertex_index, vertex_index>, vertex_index, edge_hasher> edge_vertex_map;
+    std::pmr::vector<face> faces{octahedron_faces.begin(), octahedron_faces.end()};
+    std::pmr::vector<face> result_faces{resource};
 
-    const auto create_or_reuse_midpoint_vertex = [&](const vertex_index v0, const vertex_index v1) -> vertex_index {
-      const std::pair edge{std::min(v0, v1), std::max(v0, v1)};
+    // the octahedron is consistently oriented and the subdivision preserves the orientation, so every edge is
+    // traversed exactly once as (a, b) with a < b. The face traversing an edge this way owns the edge and creates
+    // its midpoint vertex, the midpoints are numbered in the order of their owning faces.
+    const auto owns_edge = [](const face& f, const size_t e) { return f[e] < f[(e + 1) % 3]; };
 
-      auto it = edge_vertex_map.find(edge);
+    for (size_t current_level = 0; current_level < subdivision_level; ++current_level)
+    {
+      // all temporaries of a level are released at once when the level is done
+      std::pmr::monotonic_buffer_resource arena;
 
-      if (it == edge_vertex_map.end())
-      {
-        vertices.push_back(normalized(midpoint(vertices[v0], vertices[v1])));
-        it = edge_vertex_map.insert(std::pair{edge, vertices.size() - 1}).first;
-      }
+      const auto num_faces = faces.size();
+      const auto num_level_tasks = num_tasks(num_faces);
 
-      return it->second;
-    };
+      // first_midpoint[fi] is the index of the first midpoint vertex created by face fi
+      std::pmr::vector<size_t> first_midpoint(num_faces + 1, &arena);
+      parallel_for_slices(num_faces, num_level_tasks, [&](const size_t first, const size_t last) {
+        for (size_t fi = first; fi < last; ++fi)
+        {
+          const auto& f = faces[fi];
+          first_midpoint[fi + 1] = size_t{owns_edge(f, 0)} + size_t{owns_edge(f, 1)} + size_t{owns_edge(f, 2)};
+        }
+      });
 
-    for (size_t current_level = 0; current_level < num_sudivisions; ++current_level)
-    {
-      faces_container this_level_faces;
+      first_midpoint[0] = vertices.size();
+      std::partial_sum(first_midpoint.begin(), first_midpoint.end(), first_midpoint.begin());
 
-      for (const auto& f : faces)
-      {
-        const auto a = create_or_reuse_midpoint_vertex(f[0], f[1]);
-        const auto b = create_or_reuse_midpoint_vertex(f[1], f[2]);
-        const auto c = create_or_reuse_midpoint_vertex(f[2], f[0]);
-
-        this_level_faces.insert({a, b, c});
-        this_level_faces.insert({f[0], a, c});
-        this_level_faces.insert({a, f[1], b});
-        this_level_faces.insert({c, b, f[2]});
-      }
+      const auto num_edges = first_midpoint[num_faces] - vertices.size();
+      vertices.resize(first_midpoint[num_faces]);
+      edge_midpoint_table midpoints{num_edges, &arena};
+
+      parallel_for_slices(num_faces, num_level_tasks, [&](const size_t first, const size_t last) {
+        for (size_t fi = first; fi < last; ++fi)
+        {
+          const auto& f = faces[fi];
+          auto vi = first_midpoint[fi];
+
+          for (size_t e = 0; e < 3; ++e)
+          {
+            if (!owns_edge(f, e))
+              continue;
+
+            const auto v0 = f[e];
+            const auto v1 = f[(e + 1) % 3];
+            vertices[vi] = normalized(midpoint(vertices[v0], vertices[v1]));
+            midpoints.insert(v0, v1, detail::narrow_index<vertex_index>(vi++));
+          }
+        }
+      });
+
+      const auto last_level = current_level + 1 == subdivision_level;
+      std::pmr::vector<face> next_level_faces;
+      auto& this_level_faces = last_level ? result_faces : next_level_faces;
+      this_level_faces.resize(4 * num_faces);
 
-      std::swap(faces, this_level_faces);
+      parallel_for_slices(num_faces, num_level_tasks, [&](const size_t first, const size_t last) {
+        for (size_t fi = first; fi < last; ++fi)
+        {
+          const auto& f = faces[fi];
+          const auto a = midpoints.find(f[0], f[1]);
+          const auto b = midpoints.find(f[1], f[2]);
+          const auto c = midpoints.find(f[2], f[0]);
+
+          this_level_faces[4 * fi + 0] = {a, b, c};
+          this_level_faces[4 * fi + 1] = {f[0], a, c};
+          this_level_faces[4 * fi + 2] = {a, f[1], b};
+          this_level_faces[4 * fi + 3] = {c, b, f[2]};
+        }
+      });
+
+      if (!last_level)
+        std::swap(faces, next_level_faces);
     }
 
-    const auto perturbe_vertex = [rd = std::mt19937{42},
-                                  dis = std::normal_distribution<float>{1.f, stddev}](const vec3f& v) mutable {
-      vec3f r{};
-      std::ranges::transform(v, r.begin(), std::bind_front(std::multiplies<>{}, dis(rd)));
-      return r;
-    };
+    // the noise is drawn from a separate generator per block of vertices, so the result doesn't depend on the
+    // number of threads
+    static constexpr size_t vertices_per_noise_block = 1 << 16;
+    const auto num_noise_blocks = (vertices.size() + vertices_per_noise_block - 1) / vertices_per_noise_block;
+
+    parallel_for_slices(num_noise_blocks, num_tasks(vertices.size()), [&](const size_t first, const size_t last) {
+      for (size_t block = first; block < last; ++block)
+      {
+        std::seed_seq seed{size_t{42}, block};
+        std::mt19937 rd{seed};
+        std::normal_distribution<float> dis{1.f, stddev};
+
+        const auto first_vertex = block * vertices_per_noise_block;
+        const auto block_vertices = std::span{vertices}.subspan(
+          first_vertex, std::min(vertices_per_noise_block, vertices.size() - first_vertex));
+
+        for (auto& v : block_vertices)
+          std::ranges::transform(v, v.begin(), std::bind_front(std::multiplies<>{}, dis(rd)));
+      }
+    });
+
+    if (subdivision_level == 0)
+      result_faces.assign(faces.begin(), faces.end());
 
-    auto mesh = std::make_unique<tri_mesh_impl>();
-    std::ranges::for_each(vertices, std::bind_front(&tri_mesh_impl::add_vertex, mesh.get()), perturbe_vertex);
-    std::ranges::for_each(faces, std::bind_front(&tri_mesh_impl::add_face, mesh.get()));
+    auto mesh = std::make_unique<tri_mesh_impl>(std::move(vertices), std::move(result_faces), resource);
+    mesh->update_adjacency();
     return mesh;
   }
 }  // namespace quxflux
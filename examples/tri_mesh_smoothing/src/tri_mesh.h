@@ -3,19 +3,83 @@
 #include "abstract_base.h"
 
 #include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <limits>
 #include <memory>
+#include <memory_resource>
+#include <optional>
 #include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace quxflux
 {
   using vec3f = std::array<float, 3>;
+#ifdef QUXFLUX_TRI_MESH_32BIT_INDICES
+  // halves the size of faces and neighbor lists, limits meshes to less than 2^32 vertices and faces
+  using vertex_index = uint32_t;
+  using face_index = uint32_t;
+#else
   using vertex_index = size_t;
   using face_index = size_t;
+#endif
+  using face = std::array<vertex_index, 3>;
 
+  namespace detail
+  {
+    class adjacency_cache;
+
+    // converts a size or position into an index type, the caller guarantees that i is representable
+    template<typename Index>
+    constexpr Index narrow_index(const size_t i) noexcept
+    {
+      if constexpr (std::same_as<Index, size_t>)
+        return i;
+      else
+        return static_cast<Index>(i);
+    }
+
+    // converts a size or position originating from outside (e.g. a file) into an index type, throws
+    // std::overflow_error if i is not representable
+    template<typename Index>
+    Index checked_index(const size_t i)
+    {
+      if constexpr (!std::same_as<Index, size_t>)
+        if (i > std::numeric_limits<Index>::max())
+          throw std::overflow_error("index " + std::to_string(i) + " exceeds the range of the mesh index type");
+
+      return narrow_index<Index>(i);
+    }
+  }  // namespace detail
+
+  // read-only view onto a vertex adjacency stored in compressed sparse row format: the neighbors of vertex i are
+  // neighbors[offsets[i], offsets[i + 1])
+  struct adjacency_view
+  {
+    std::span<const size_t> offsets;
+    std::span<const vertex_index> neighbors;
+
+    // takes a size_t instead of a vertex_index, so that vertices can be enumerated using plain size_t loops
+    std::span<const vertex_index> operator[](const size_t i) const
+    {
+      return neighbors.subspan(offsets[i], offsets[i + 1] - offsets[i]);
+    }
+  };
+
+  // const member functions of implementations must be safe to be called concurrently from multiple threads
   struct tri_mesh : abstract_base
   {
-    virtual std::unique_ptr<tri_mesh> clone() const = 0;
+    // copies the mesh, the storage of the copy (but not the tri_mesh object itself) is allocated from resource,
+    // which has to outlive the copy. Implementations which can't allocate from a memory resource ignore it.
+    std::unique_ptr<tri_mesh> clone(std::pmr::memory_resource* const resource = std::pmr::get_default_resource()) const
+    {
+      return do_clone(resource);
+    }
 
     virtual size_t get_num_vertices() const = 0;
     virtual void get_vertex(const vertex_index i, float* const data) const = 0;
@@ -27,12 +91,50 @@ namespace quxflux
     virtual size_t get_num_faces() const = 0;
     virtual void get_face(const face_index i, vertex_index* const data) const = 0;
     virtual void set_face(const face_index i, const vertex_index* const data) = 0;
+
+    // bulk access: copies a contiguous range of elements with a single virtual call. The default implementations
+    // fall back to the per element functions above, implementations should override them if they can do better.
+    virtual void get_vertices(const vertex_index first, const std::span<vec3f> out) const
+    {
+      for (vertex_index i = 0; i < out.size(); ++i)
+        get_vertex(first + i, out[i].data());
+    }
+
+    virtual void set_vertices(const vertex_index first, const std::span<const vec3f> data)
+    {
+      for (vertex_index i = 0; i < data.size(); ++i)
+        set_vertex(first + i, data[i].data());
+    }
+
+    virtual void get_faces(const face_index first, const std::span<face> out) const
+    {
+      for (face_index i = 0; i < out.size(); ++i)
+        get_face(first + i, out[i].data());
+    }
+
+    // opt-in zero-copy access: implementations which store their data contiguously may hand out views onto it,
+    // std::nullopt signals that the data has to be accessed through the functions above. Views are invalidated
+    // by any call to a non-const member function.
+    virtual std::optional<std::span<const vec3f>> vertices() const { return std::nullopt; }
+    virtual std::optional<std::span<const face>> faces() const { return std::nullopt; }
+    virtual std::optional<adjacency_view> adjacency() const { return std::nullopt; }
+
+    // opt-in cache of data derived from the adjacency, which is kept until the faces change. Copies of the mesh share
+    // the cache of the original until the faces of either one change. nullptr signals that the implementation
+    // doesn't cache anything.
+    virtual detail::adjacency_cache* adjacency_cache() const { return nullptr; }
+
+  protected:
+    virtual std::unique_ptr<tri_mesh> do_clone(std::pmr::memory_resource* resource) const = 0;
   };
 
   inline auto mesh_vertices(const tri_mesh& mesh)
   {
     return std::views::iota(uint32_t{0}, static_cast<uint32_t>(mesh.get_num_vertices()))  //
-           | std::views::transform([&](const auto vi) {
+           | std::views::transform([&mesh, view = mesh.vertices()](const auto vi) {
+               if (view)
+                 return (*view)[vi];
+
                vec3f vertex;
                mesh.get_vertex(vi, vertex.data());
                return vertex;
@@ -42,15 +144,63 @@ namespace quxflux
   inline auto mesh_faces(const tri_mesh& mesh)
   {
     return std::views::iota(uint32_t{0}, static_cast<uint32_t>(mesh.get_num_faces()))  //
-           | std::views::transform([&](const auto fi) {
-               std::array<vertex_index, 3> f;
+           | std::views::transform([&mesh, view = mesh.faces()](const auto fi) {
+               if (view)
+                 return (*view)[fi];
+
+               face f;
                mesh.get_face(fi, f.data());
                return f;
              });
   }
 
-  std::unique_ptr<tri_mesh> read_from_file(const std::filesystem::path& path);
-  void write_to_file(const tri_mesh& mesh, const std::filesystem::path& path);
+  // reads a mesh from a wavefront obj file. The file is memory mapped and split into num_threads line-aligned
+  // chunks which are parsed in parallel (0 selects std::thread::hardware_concurrency()). Polygons are triangulated
+  // as fans. The vertices, faces and adjacency of the mesh are allocated from resource, which has to outlive the mesh.
+  // Throws if the file can't be mapped or is malformed.
+  std::unique_ptr<tri_mesh> read_from_file(const std::filesystem::path& path, size_t num_threads = 1,
+                                           std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+  // writes a mesh to a wavefront obj file. Coordinates are written in shortest round-trip representation, so
+  // reading the file yields exactly the same mesh. The vertex and face blocks are formatted using num_threads
+  // threads (0 selects std::thread::hardware_concurrency()), the format buffers are allocated from resource.
+  void write_to_file(const tri_mesh& mesh, const std::filesystem::path& path, size_t num_threads = 1,
+                     std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+  // native binary format consisting of a header followed by the vertex, face and adjacency (compressed sparse row)
+  // blocks. read_binary memory maps the file and uses the blocks in place without parsing or copying them.
+  // Modifications of the returned mesh are private to it and never written back to the file. The file format
+  // depends on the byte order and index widths of the platform, read_binary throws if they don't match.
+  void write_binary(const tri_mesh& mesh, const std::filesystem::path& path);
+
+  // the checks read_binary performs on the file before using its blocks
+  enum class binary_mesh_validation
+  {
+    // the header and the block layout, which takes constant time and leaves the blocks untouched until they are
+    // accessed. Sufficient for files written by write_binary.
+    layout,
+    // additionally every face index, adjacency offset and neighbor index, which reads the whole file. The blocks are
+    // used without bounds checks, so files from untrusted sources have to be read with this.
+    indices
+  };
+
+  std::unique_ptr<tri_mesh> read_binary(const std::filesystem::path& path,
+                                        binary_mesh_validation validation = binary_mesh_validation::layout);
+
+  // renumbers the vertices of the mesh in reverse Cuthill-McKee order, so that the neighbors of a vertex are stored
+  // close to it, and updates the faces accordingly. The order of the faces is kept. Returns the permutation: the
+  // vertex at index i after reordering was at index result[i] before.
+  std::vector<vertex_index> reorder_vertices(tri_mesh& mesh);
+
+  // the number of vertices per valence: result[v] is the number of vertices with v neighbors. The result has an
+  // entry for every valence up to the highest one of the mesh.
+  std::vector<size_t> vertex_valence_histogram(const tri_mesh& mesh);
 
-  std::unique_ptr<tri_mesh> generate_noisy_unit_sphere(size_t subdivision_level, const float stddev);
+  // generates a unit sphere by subdividing an octahedron subdivision_level times and scales each vertex by a
+  // normally distributed factor with mean 1. Each level is subdivided using num_threads threads (0 selects
+  // std::thread::hardware_concurrency()), the result is the same for any number of threads. The vertices, faces and
+  // adjacency of the mesh are allocated from resource, the temporaries of the subdivision are not. Throws
+  // std::invalid_argument for subdivision levels above 14.
+  std::unique_ptr<tri_mesh> generate_noisy_unit_sphere(
+    size_t subdivision_level, const float stddev, size_t num_threads = 1,
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 }  // namespace quxflux
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "adjacency_cache.h"
+#include "tri_mesh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+namespace quxflux::detail
+{
+  // vertex adjacency in compressed sparse row format: the neighbors of vertex i are stored contiguously in
+  // neighbors_[offsets_[i], offsets_[i + 1]). The adjacency is (re)built from the faces on the first access after
+  // it has been invalidated. Concurrent access is safe, the first accessor rebuilds while the others wait. Copies
+  // share the adjacency_cache until they are invalidated.
+  class lazy_adjacency
+  {
+  public:
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    explicit lazy_adjacency(const allocator_type& alloc = {});
+    explicit lazy_adjacency(const adjacency_view& adjacency, const allocator_type& alloc = {});
+    lazy_adjacency(const lazy_adjacency& other, const allocator_type& alloc = {});
+    lazy_adjacency& operator=(const lazy_adjacency&) = delete;
+
+    void invalidate()
+    {
+      dirty_ = true;
+      cache_.reset();
+    }
+
+    adjacency_view get(size_t num_vertices, std::span<const face> faces) const;
+    adjacency_cache& cache() const;
+
+  private:
+    void build(size_t num_vertices, std::span<const face> faces) const;
+
+    mutable std::pmr::vector<size_t> offsets_;
+    mutable std::pmr::vector<vertex_index> neighbors_;
+    mutable std::atomic<bool> dirty_ = true;
+    // created on first use, so that invalidating doesn't allocate
+    mutable std::shared_ptr<adjacency_cache> cache_;
+    mutable std::mutex mutex_;
+  };
+
+  // copy of the adjacency of a mesh which doesn't provide a view onto its own
+  struct adjacency_storage
+  {
+    explicit adjacency_storage(const tri_mesh& mesh);
+
+    adjacency_view view() const { return {offsets, neighbors}; }
+
+    std::vector<size_t> offsets;
+    std::vector<vertex_index> neighbors;
+  };
+
+  // the tri_mesh implementation used by the mesh generators and readers, stores its data contiguously and
+  // therefore provides all of the optional bulk and zero-copy accessors. All of its storage, including the
+  // adjacency, is allocated using the allocator passed on construction. The entries of its adjacency_cache are not.
+  struct tri_mesh_impl : tri_mesh
+  {
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    explicit tri_mesh_impl(const allocator_type& alloc = {});
+    // vertices and faces are moved if they use the same allocator and copied otherwise
+    tri_mesh_impl(std::pmr::vector<vec3f> vertices, std::pmr::vector<face> faces, const allocator_type& alloc = {});
+    // takes a copy of an adjacency which is known to match the faces instead of building it
+    tri_mesh_impl(std::pmr::vector<vec3f> vertices, std::pmr::vector<face> faces, const adjacency_view& adjacency,
+                  const allocator_type& alloc = {});
+    tri_mesh_impl(const tri_mesh_impl& other, const allocator_type& alloc = {});
+
+    allocator_type get_allocator() const { return vertices_.get_allocator(); }
+
+    size_t get_num_vertices() const final { return vertices_.size(); }
+
+    void get_vertex(const vertex_index i, float* const data) const final { std::ranges::copy(vertices_[i], data); }
+
+    void set_vertex(const vertex_index i, const float* const data) final
+    {
+      std::ranges::copy_n(data, 3, vertices_[i].begin());
+    }
+
+    size_t get_vertex_valence(const vertex_index i) const final { return get_adjacency()[i].size(); }
+
+    size_t get_vertex_neighbors(const vertex_index i, vertex_index* const buf, const size_t buf_size) const final
+    {
+      const auto neighbors = get_adjacency()[i];
+      const auto n = std::min(buf_size, neighbors.size());
+      std::copy_n(neighbors.begin(), n, buf);
+
+      return n;
+    }
+
+    size_t get_num_faces() const final { return faces_.size(); }
+
+    void get_face(const face_index i, vertex_index* const data) const final { std::ranges::copy(faces_[i], data); }
+
+    void set_face(const face_index i, const vertex_index* const data) final
+    {
+      std::ranges::copy_n(data, 3, faces_[i].begin());
+      adjacency_.invalidate();
+    }
+
+    void get_vertices(const vertex_index first, const std::span<vec3f> out) const final
+    {
+      std::ranges::copy(std::span{vertices_}.subspan(first, out.size()), out.begin());
+    }
+
+    void set_vertices(const vertex_index first, const std::span<const vec3f> data) final
+    {
+      std::ranges::copy(data, vertices_.begin() + static_cast<std::ptrdiff_t>(first));
+    }
+
+    void get_faces(const face_index first, const std::span<face> out) const final
+    {
+      std::ranges::copy(std::span{faces_}.subspan(first, out.size()), out.begin());
+    }
+
+    std::optional<std::span<const vec3f>> vertices() const final { return vertices_; }
+    std::optional<std::span<const face>> faces() const final { return faces_; }
+    std::optional<adjacency_view> adjacency() const final { return get_adjacency(); }
+    detail::adjacency_cache* adjacency_cache() const final { return &adjacency_.cache(); }
+
+    void add_vertex(const vec3f& v)
+    {
+      vertices_.push_back(v);
+      adjacency_.invalidate();
+    }
+
+    void add_face(const face& f)
+    {
+      faces_.push_back(f);
+      adjacency_.invalidate();
+    }
+
+    // (re)builds the adjacency if vertices or faces changed since it was built the last time
+    void update_adjacency() const { get_adjacency(); }
+
+  protected:
+    std::unique_ptr<tri_mesh> do_clone(std::pmr::memory_resource* const resource) const final
+    {
+      return std::make_unique<tri_mesh_impl>(*this, resource);
+    }
+
+  private:
+    adjacency_view get_adjacency() const { return adjacency_.get(vertices_.size(), faces_); }
+
+    std::pmr::vector<vec3f> vertices_;
+    std::pmr::vector<face> faces_;
+    lazy_adjacency adjacency_;
+  };
+}  // namespace quxflux::detail
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "tri_mesh.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <ranges>
+#include <span>
+
+namespace quxflux::detail
+{
+  // the smoothed position of vertex i: the average of its neighbors, or its own position if it has none. All
+  // kernels which claim to be bit-identical to the scalar implementation have to sum up the neighbors in the same
+  // order and multiply by the same reciprocal. Neighbors may use any index type, e.g. tile local indices.
+  template<std::ranges::sized_range Neighbors>
+  vec3f averaged_neighbors(const size_t i, const Neighbors& neighbor_indices, const std::span<const vec3f> org_vertices)
+  {
+    if (std::ranges::empty(neighbor_indices)) [[unlikely]]
+      return org_vertices[i];
+
+    vec3f smoothed{};
+
+    for (const auto vi : neighbor_indices)
+      std::ranges::transform(smoothed, org_vertices[vi], smoothed.begin(), std::plus<>{});
+
+    const auto n_recip = 1.f / static_cast<float>(std::ranges::size(neighbor_indices));
+    std::ranges::transform(smoothed, smoothed.begin(), std::bind_front(std::multiplies<>{}, n_recip));
+
+    return smoothed;
+  }
+}  // namespace quxflux::detail